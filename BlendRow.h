@@ -0,0 +1,366 @@
+#ifndef BlendRow_DEFINED
+#define BlendRow_DEFINED
+
+#include "GPixel.h"
+#include "GBlendMode.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+// Scalar blend procs and the span kernels built on them. The SIMD kernels run the exact same
+// integer math as quad_mul_div255, so every mode matches its scalar proc bit for bit.
+
+// turn 0xAABBCCDD into 0x00AA00CC00BB00DD
+static inline uint64_t expand(uint32_t x) {
+    uint64_t hi = x & 0xFF00FF00;  // the A and G components
+    uint64_t lo = x & 0x00FF00FF;// the R and B components
+    return (hi << 24) | lo;
+}
+
+// turn 0xXX into 0x00XX00XX00XX00XX
+static inline uint64_t replicate(uint64_t x) {
+    return (x << 48) | (x << 32) | (x << 16) | x;
+}
+
+// turn 0x..AA..CC..BB..DD into 0xAABBCCDD
+static inline uint32_t compact(uint64_t x) {
+    return ((x >> 24) & 0xFF00FF00) | (x & 0xFF00FF);
+}
+
+static inline uint32_t quad_mul_div255(uint32_t x, uint8_t invA) {
+    uint64_t prod = expand(x) * invA;
+    prod += replicate(128);
+    prod += (prod >> 8) & replicate(0xFF);
+    prod >>= 8;
+    return compact(prod);
+}
+
+// Define a new type BlendProc for the per-pixel blend functions
+typedef GPixel (* BlendProc)(GPixel, GPixel);
+
+// Blend functions
+static inline GPixel Clear(GPixel source, GPixel destination) {
+    return 0;
+}
+
+static inline GPixel Source(GPixel source, GPixel destination) {
+    return source;
+}
+
+static inline GPixel Destination(GPixel source, GPixel destination) {
+    return destination;
+}
+
+static inline GPixel SourceOver(GPixel source, GPixel destination) {
+    int sourceAlpha = GPixel_GetA(source);
+    return source + quad_mul_div255(destination, 255 - sourceAlpha);
+}
+
+static inline GPixel DestinationOver(GPixel source, GPixel destination) {
+    int destAlpha = GPixel_GetA(destination);
+    return destination + quad_mul_div255(source, 255 - destAlpha);
+}
+
+static inline GPixel SourceIn(GPixel source, GPixel destination) {
+    int destAlpha = GPixel_GetA(destination);
+    return quad_mul_div255(source, destAlpha);
+}
+
+static inline GPixel DestinationIn(GPixel source, GPixel destination) {
+    int sourceAlpha = GPixel_GetA(source);
+    return quad_mul_div255(destination, sourceAlpha);
+}
+
+static inline GPixel SourceOut(GPixel source, GPixel destination) {
+    int destAlpha = GPixel_GetA(destination);
+    return quad_mul_div255(source, 255 - destAlpha);
+}
+
+static inline GPixel DestinationOut(GPixel source, GPixel destination) {
+    int sourceAlpha = GPixel_GetA(source);
+    return quad_mul_div255(destination, 255 - sourceAlpha);
+}
+
+static inline GPixel SourceAtTop(GPixel source, GPixel destination) {
+    int sourceAlpha = GPixel_GetA(source);
+    int destAlpha = GPixel_GetA(destination);
+    return quad_mul_div255(source, destAlpha) + quad_mul_div255(destination, 255 - sourceAlpha);
+}
+
+static inline GPixel DestinationAtTop(GPixel source, GPixel destination) {
+    int sourceAlpha = GPixel_GetA(source);
+    int destAlpha = GPixel_GetA(destination);
+    return quad_mul_div255(source, 255 - destAlpha)
+           + quad_mul_div255(destination, sourceAlpha);
+}
+
+static inline GPixel Xor(GPixel source, GPixel destination) {
+    int sourceAlpha = GPixel_GetA(source);
+    int destAlpha = GPixel_GetA(destination);
+    return quad_mul_div255(source, 255 - destAlpha) + quad_mul_div255(destination, 255 - sourceAlpha);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Vector backends. Each one holds N pixels in a register, and a "Scale" is one 8-bit factor per
+// pixel widened to 16-bit lanes, so quad_mul_div255 becomes a mullo/add/shift on 16-bit lanes.
+
+#if defined(__SSE2__)
+struct SSE2Pixels {
+    typedef __m128i V;
+    struct Scale { __m128i lo, hi; };
+    enum { N = 4 };
+
+    static V load(const GPixel* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(GPixel* p, V v) { _mm_storeu_si128((__m128i*)p, v); }
+    static V splat(GPixel p) { return _mm_set1_epi32((int)p); }
+    static V zero() { return _mm_setzero_si128(); }
+    static V add(V a, V b) { return _mm_add_epi32(a, b); }
+
+    // alpha of each pixel, replicated over that pixel's four 16-bit lanes
+    static Scale alpha(V p) {
+        __m128i lo = _mm_unpacklo_epi8(p, _mm_setzero_si128());
+        __m128i hi = _mm_unpackhi_epi8(p, _mm_setzero_si128());
+        lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+        hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+        return { lo, hi };
+    }
+    // coverage[0..3], each replicated over its pixel's four 16-bit lanes
+    static Scale coverage(const uint8_t* c) {
+        int32_t bytes;
+        memcpy(&bytes, c, 4);
+        __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), _mm_setzero_si128());
+        v = _mm_unpacklo_epi16(v, v);
+        return { _mm_unpacklo_epi32(v, v), _mm_unpackhi_epi32(v, v) };
+    }
+    static Scale invert(Scale s) {
+        const __m128i k255 = _mm_set1_epi16(255);
+        return { _mm_sub_epi16(k255, s.lo), _mm_sub_epi16(k255, s.hi) };
+    }
+    static __m128i mulDiv255(__m128i x, __m128i s) {
+        __m128i prod = _mm_add_epi16(_mm_mullo_epi16(x, s), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(prod, _mm_srli_epi16(prod, 8)), 8);
+    }
+    static V mul(V p, Scale s) {
+        __m128i lo = mulDiv255(_mm_unpacklo_epi8(p, _mm_setzero_si128()), s.lo);
+        __m128i hi = mulDiv255(_mm_unpackhi_epi8(p, _mm_setzero_si128()), s.hi);
+        return _mm_packus_epi16(lo, hi);
+    }
+};
+#endif
+
+#if defined(__AVX2__)
+// Same lane layout as SSE2Pixels; unpack/shuffle/pack all stay within each 128-bit half, so the
+// pixel order survives the round trip.
+struct AVX2Pixels {
+    typedef __m256i V;
+    struct Scale { __m256i lo, hi; };
+    enum { N = 8 };
+
+    static V load(const GPixel* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(GPixel* p, V v) { _mm256_storeu_si256((__m256i*)p, v); }
+    static V splat(GPixel p) { return _mm256_set1_epi32((int)p); }
+    static V zero() { return _mm256_setzero_si256(); }
+    static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+
+    static Scale alpha(V p) {
+        __m256i lo = _mm256_unpacklo_epi8(p, _mm256_setzero_si256());
+        __m256i hi = _mm256_unpackhi_epi8(p, _mm256_setzero_si256());
+        lo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xFF), 0xFF);
+        hi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xFF), 0xFF);
+        return { lo, hi };
+    }
+    // Pixels 0-3 are in the low half and 4-7 in the high half, each half laid out as in SSE2
+    static Scale coverage(const uint8_t* c) {
+        SSE2Pixels::Scale a = SSE2Pixels::coverage(c), b = SSE2Pixels::coverage(c + 4);
+        return { _mm256_inserti128_si256(_mm256_castsi128_si256(a.lo), b.lo, 1),
+                 _mm256_inserti128_si256(_mm256_castsi128_si256(a.hi), b.hi, 1) };
+    }
+    static Scale invert(Scale s) {
+        const __m256i k255 = _mm256_set1_epi16(255);
+        return { _mm256_sub_epi16(k255, s.lo), _mm256_sub_epi16(k255, s.hi) };
+    }
+    static __m256i mulDiv255(__m256i x, __m256i s) {
+        __m256i prod = _mm256_add_epi16(_mm256_mullo_epi16(x, s), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(prod, _mm256_srli_epi16(prod, 8)), 8);
+    }
+    static V mul(V p, Scale s) {
+        __m256i lo = mulDiv255(_mm256_unpacklo_epi8(p, _mm256_setzero_si256()), s.lo);
+        __m256i hi = mulDiv255(_mm256_unpackhi_epi8(p, _mm256_setzero_si256()), s.hi);
+        return _mm256_packus_epi16(lo, hi);
+    }
+};
+#endif
+
+#if defined(__AVX2__)
+typedef AVX2Pixels BlendPixels;
+#elif defined(__SSE2__)
+typedef SSE2Pixels BlendPixels;
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// One struct per GBlendMode: the scalar proc for tails, and the vector form for whole registers.
+
+#define BLEND_MODE(Name, scalarProc, body)                                          \
+    struct Name {                                                                   \
+        static GPixel scalar(GPixel s, GPixel d) { return scalarProc(s, d); }       \
+        template <typename P> static typename P::V vec(typename P::V s,             \
+                                                      typename P::V d) { body }     \
+    };
+
+BLEND_MODE(ClearMode,    Clear,            return P::zero();)
+BLEND_MODE(SrcMode,      Source,           return s;)
+BLEND_MODE(DstMode,      Destination,      return d;)
+BLEND_MODE(SrcOverMode,  SourceOver,       return P::add(s, P::mul(d, P::invert(P::alpha(s))));)
+BLEND_MODE(DstOverMode,  DestinationOver,  return P::add(d, P::mul(s, P::invert(P::alpha(d))));)
+BLEND_MODE(SrcInMode,    SourceIn,         return P::mul(s, P::alpha(d));)
+BLEND_MODE(DstInMode,    DestinationIn,    return P::mul(d, P::alpha(s));)
+BLEND_MODE(SrcOutMode,   SourceOut,        return P::mul(s, P::invert(P::alpha(d)));)
+BLEND_MODE(DstOutMode,   DestinationOut,   return P::mul(d, P::invert(P::alpha(s)));)
+BLEND_MODE(SrcATopMode,  SourceAtTop,      return P::add(P::mul(s, P::alpha(d)),
+                                                         P::mul(d, P::invert(P::alpha(s))));)
+BLEND_MODE(DstATopMode,  DestinationAtTop, return P::add(P::mul(s, P::invert(P::alpha(d))),
+                                                         P::mul(d, P::alpha(s)));)
+BLEND_MODE(XorMode,      Xor,              return P::add(P::mul(s, P::invert(P::alpha(d))),
+                                                         P::mul(d, P::invert(P::alpha(s))));)
+
+#undef BLEND_MODE
+
+// Blend a row of shaded source pixels into dst[0..count-1]
+template <typename Mode> void blendRow(GPixel dst[], const GPixel src[], int count) {
+    int i = 0;
+#if defined(__SSE2__)
+    typedef BlendPixels P;
+    // two registers per iteration: 8 pixels with SSE2, 16 with AVX2
+    for (; i + 2 * P::N <= count; i += 2 * P::N) {
+        typename P::V d0 = P::load(dst + i);
+        typename P::V d1 = P::load(dst + i + P::N);
+        P::store(dst + i,        Mode::template vec<P>(P::load(src + i), d0));
+        P::store(dst + i + P::N, Mode::template vec<P>(P::load(src + i + P::N), d1));
+    }
+    for (; i + P::N <= count; i += P::N) {
+        P::store(dst + i, Mode::template vec<P>(P::load(src + i), P::load(dst + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = Mode::scalar(src[i], dst[i]);
+    }
+}
+
+// Blend a single source color into dst[0..count-1]
+template <typename Mode> void blendRowConst(GPixel dst[], GPixel src, int count) {
+    int i = 0;
+#if defined(__SSE2__)
+    typedef BlendPixels P;
+    const typename P::V s = P::splat(src);
+    for (; i + 2 * P::N <= count; i += 2 * P::N) {
+        typename P::V d0 = P::load(dst + i);
+        typename P::V d1 = P::load(dst + i + P::N);
+        P::store(dst + i,        Mode::template vec<P>(s, d0));
+        P::store(dst + i + P::N, Mode::template vec<P>(s, d1));
+    }
+    for (; i + P::N <= count; i += P::N) {
+        P::store(dst + i, Mode::template vec<P>(s, P::load(dst + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = Mode::scalar(src, dst[i]);
+    }
+}
+
+// Mix a row of blended pixels into dst by coverage: dst = src * c + dst * (1 - c)
+static void lerpRow(GPixel dst[], const GPixel src[], const uint8_t coverage[], int count) {
+    int i = 0;
+#if defined(__SSE2__)
+    typedef BlendPixels P;
+    for (; i + P::N <= count; i += P::N) {
+        typename P::Scale c = P::coverage(coverage + i);
+        P::store(dst + i, P::add(P::mul(P::load(src + i), c),
+                                 P::mul(P::load(dst + i), P::invert(c))));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = quad_mul_div255(src[i], coverage[i]) + quad_mul_div255(dst[i], 255 - coverage[i]);
+    }
+}
+
+// Rows whose result doesn't depend on dst (or is dst) need no blending at all
+static void clearRow(GPixel dst[], const GPixel[], int count) {
+    memset(dst, 0, count * sizeof(GPixel));
+}
+
+static void copyRow(GPixel dst[], const GPixel src[], int count) {
+    memcpy(dst, src, count * sizeof(GPixel));
+}
+
+static void keepRow(GPixel[], const GPixel[], int) {}
+
+static void clearRowConst(GPixel dst[], GPixel, int count) {
+    memset(dst, 0, count * sizeof(GPixel));
+}
+
+static void fillRowConst(GPixel dst[], GPixel src, int count) {
+    for (int i = 0; i < count; ++i) {
+        dst[i] = src;
+    }
+}
+
+static void keepRowConst(GPixel[], GPixel, int) {}
+
+typedef void (* BlendRowProc)(GPixel dst[], const GPixel src[], int count);
+typedef void (* BlendRowConstProc)(GPixel dst[], GPixel src, int count);
+
+// Indexed by GBlendMode
+static const BlendRowProc gBlendRowProcs[12] = {
+    clearRow,              copyRow,               keepRow,               blendRow<SrcOverMode>,
+    blendRow<DstOverMode>, blendRow<SrcInMode>,   blendRow<DstInMode>,   blendRow<SrcOutMode>,
+    blendRow<DstOutMode>,  blendRow<SrcATopMode>, blendRow<DstATopMode>, blendRow<XorMode>,
+};
+
+static const BlendRowConstProc gBlendRowConstProcs[12] = {
+    clearRowConst,              fillRowConst,               keepRowConst,
+    blendRowConst<SrcOverMode>, blendRowConst<DstOverMode>, blendRowConst<SrcInMode>,
+    blendRowConst<DstInMode>,   blendRowConst<SrcOutMode>,  blendRowConst<DstOutMode>,
+    blendRowConst<SrcATopMode>, blendRowConst<DstATopMode>, blendRowConst<XorMode>,
+};
+
+/**
+ *  Return the cheapest mode that gives exactly the same result as mode for every dst, when
+ *  every source pixel is known to be opaque (alpha 255) or known to be transparent (all zero).
+ *  The substitutions hold bit for bit under quad_mul_div255: x * 255 / 255 == x, x * 0 == 0.
+ */
+static inline GBlendMode reduceBlendMode(GBlendMode mode, bool srcOpaque, bool srcTransparent) {
+    if (srcOpaque) {
+        switch (mode) {
+            case GBlendMode::kSrcOver:  return GBlendMode::kSrc;
+            case GBlendMode::kDstIn:    return GBlendMode::kDst;
+            case GBlendMode::kDstOut:   return GBlendMode::kClear;
+            case GBlendMode::kSrcATop:  return GBlendMode::kSrcIn;
+            case GBlendMode::kDstATop:  return GBlendMode::kDstOver;
+            case GBlendMode::kXor:      return GBlendMode::kSrcOut;
+            default:                    return mode;
+        }
+    }
+    if (srcTransparent) {
+        switch (mode) {
+            case GBlendMode::kSrcOver:
+            case GBlendMode::kDstOver:
+            case GBlendMode::kDstOut:
+            case GBlendMode::kSrcATop:
+            case GBlendMode::kXor:      return GBlendMode::kDst;
+            case GBlendMode::kSrc:
+            case GBlendMode::kSrcIn:
+            case GBlendMode::kDstIn:
+            case GBlendMode::kSrcOut:
+            case GBlendMode::kDstATop:  return GBlendMode::kClear;
+            default:                    return mode;
+        }
+    }
+    return mode;
+}
+
+#endif
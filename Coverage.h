@@ -0,0 +1,215 @@
+#ifndef Coverage_DEFINED
+#define Coverage_DEFINED
+
+#include "GPoint.h"
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+/**
+ *  Exact area coverage for anti-aliased fills. Each line adds, to the cells it crosses, the
+ *  signed area between itself and the right edge of the cell (positive going down, negative going
+ *  up); a prefix sum along a row then turns those into the winding-weighted coverage of each
+ *  pixel. Coverage is clamped to 1, so overlapping contours follow the non-zero rule.
+ *
+ *  Rows are accumulated a band of at most kMaxRows at a time, and each row remembers the cells
+ *  its lines touched: outside them a closed contour covers nothing.
+ */
+class CoverageAccumulator {
+public:
+    enum {
+        kMaxRows = 64,
+    };
+
+    // Floats of storage for an accumulator width pixels wide
+    static size_t StorageSize(int width) {
+        return (size_t)(width + 2) * kMaxRows;
+    }
+
+    // Covers device columns [left, left + width). storage[] must be all zero; resolving every
+    // row of a band leaves it that way again. Parts of lines left or right of the columns are
+    // moved onto the nearest column bound, which keeps the winding they add to the pixels inside.
+    CoverageAccumulator(float storage[], int left, int width)
+            : fAcc(storage), fLeft(left), fWidth(width), fStride(width + 2), fTop(0), fHeight(0) {}
+
+    // Start a band of rows [top, top + height), with height <= kMaxRows
+    void setRows(int top, int height) {
+        fTop = top;
+        fHeight = height;
+        for (int i = 0; i < height; ++i) {
+            fMinCell[i] = fStride;
+            fMaxCell[i] = -1;
+        }
+    }
+
+    // Add the part of the line inside the band's rows
+    void addLine(GPoint p0, GPoint p1) {
+        if (p0.fY == p1.fY || std::max(p0.fY, p1.fY) <= fTop
+                           || std::min(p0.fY, p1.fY) >= fTop + fHeight) {
+            return;
+        }
+        const float x0 = p0.fX - fLeft, y0 = p0.fY;
+        const float x1 = p1.fX - fLeft, y1 = p1.fY;
+        // Split where the line crosses a column bound, so each piece is inside or outside
+        float ts[4] = { 0 };
+        int n = 1;
+        const float bounds[2] = { 0, (float)fWidth };
+        for (float b : bounds) {
+            if ((x0 < b) != (x1 < b)) {
+                ts[n++] = (b - x0) / (x1 - x0);
+            }
+        }
+        ts[n++] = 1;
+        // Only a line crossing both bounds has two splits, which may be in either order
+        if (n == 4 && ts[2] < ts[1]) {
+            std::swap(ts[1], ts[2]);
+        }
+        float px = x0, py = y0;
+        for (int i = 1; i < n; ++i) {
+            float nx = i == n - 1 ? x1 : x0 + ts[i] * (x1 - x0);
+            float ny = i == n - 1 ? y1 : y0 + ts[i] * (y1 - y0);
+            this->addClampedLine(clampX(px), py, clampX(nx), ny);
+            px = nx;
+            py = ny;
+        }
+    }
+
+    // The coverage (0...255) of row y's pixels [*start, *end), relative to left; the rest of the
+    // row is uncovered. Clears the row for the next band.
+    void resolveRow(int y, uint8_t coverage[], int* start, int* end) {
+        const int r = y - fTop;
+        float* row = fAcc + r * fStride;
+        const int first = fMinCell[r];
+        const int last = std::max(first, std::min(fMaxCell[r] + 1, fWidth));
+        *start = first;
+        *end = last;
+        int i = first;
+        float sum = 0;
+#if defined(__SSE2__)
+        __m128 carry = _mm_setzero_ps();
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 one = _mm_set1_ps(1);
+        const __m128 scale = _mm_set1_ps(255);
+        const __m128 half = _mm_set1_ps(0.5f);
+        // The coverage bytes of 4 pixels that add nothing to the sum so far
+        int32_t carryBytes = 0;
+        for (; i + 4 <= last; i += 4) {
+            __m128 x = _mm_loadu_ps(row + i);
+            // Most of a row is inside or outside, where no line adds anything
+            if (_mm_movemask_ps(_mm_cmpneq_ps(x, _mm_setzero_ps())) == 0) {
+                memcpy(coverage + i, &carryBytes, 4);
+                continue;
+            }
+            // Prefix sum of 4 lanes in two shifted adds, plus everything before them
+            x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+            x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+            x = _mm_add_ps(x, carry);
+            carry = _mm_shuffle_ps(x, x, 0xFF);
+            _mm_storeu_ps(row + i, _mm_setzero_ps());
+
+            __m128 a = _mm_min_ps(_mm_andnot_ps(signMask, x), one);
+            __m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(a, scale), half));
+            c = _mm_packs_epi32(c, c);
+            c = _mm_packus_epi16(c, c);
+            int32_t bytes = _mm_cvtsi128_si32(c);
+            memcpy(coverage + i, &bytes, 4);
+            carryBytes = (int32_t)(((uint32_t)bytes >> 24) * 0x01010101u);
+        }
+        sum = _mm_cvtss_f32(carry);
+#endif
+        for (; i < last; ++i) {
+            sum += row[i];
+            row[i] = 0;
+            coverage[i] = (uint8_t)(std::min(fabsf(sum), 1.0f) * 255 + 0.5f);
+        }
+        // Cells past the last pixel only hold winding moved onto the right bound
+        for (; i <= fMaxCell[r]; ++i) {
+            row[i] = 0;
+        }
+    }
+
+private:
+    float clampX(float x) const {
+        return std::max(0.0f, std::min(x, (float)fWidth));
+    }
+
+    // x0 and x1 are within the columns, y0 and y1 are device rows. Each row's crossing is
+    // computed from the line's end points, not stepped from the row above, so a row comes out
+    // the same whichever band it falls in.
+    void addClampedLine(float x0, float y0, float x1, float y1) {
+        float dir = 1;
+        if (y0 > y1) {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+            dir = -1;
+        }
+        const float top = std::max(y0, (float)fTop);
+        const float bottom = std::min(y1, (float)(fTop + fHeight));
+        if (!(top < bottom)) {
+            return;
+        }
+        const float dxdy = (x1 - x0) / (y1 - y0);
+        const int yEnd = (int)ceilf(bottom);
+        for (int y = (int)floorf(top); y < yEnd; ++y) {
+            const int r = y - fTop;
+            float* row = fAcc + r * fStride;
+            const float rowTop = std::max((float)y, y0);
+            const float rowBottom = std::min(y + 1.0f, y1);
+            const float d = (rowBottom - rowTop) * dir;
+            const float xTop = x0 + (rowTop - y0) * dxdy;
+            const float xBottom = x0 + (rowBottom - y0) * dxdy;
+            const float xa = this->clampX(std::min(xTop, xBottom));
+            const float xb = this->clampX(std::max(xTop, xBottom));
+            const float xaFloor = floorf(xa);
+            const int xaInt = (int)xaFloor;
+            const int xbInt = (int)ceilf(xb);
+            int lastCell;
+            if (xbInt <= xaInt + 1) {
+                // Within one pixel: split d at the crossing's mean x
+                const float xMid = 0.5f * (xa + xb) - xaFloor;
+                row[xaInt] += d - d * xMid;
+                row[xaInt + 1] += d * xMid;
+                lastCell = xaInt + 1;
+            } else {
+                // Across several pixels: triangles at the two ends, equal slices in between
+                const float s = 1 / (xb - xa);
+                const float xaFrac = xa - xaFloor;
+                const float a0 = 0.5f * s * (1 - xaFrac) * (1 - xaFrac);
+                const float xbFrac = xb - xbInt + 1;
+                const float am = 0.5f * s * xbFrac * xbFrac;
+                row[xaInt] += d * a0;
+                if (xbInt == xaInt + 2) {
+                    row[xaInt + 1] += d * (1 - a0 - am);
+                } else {
+                    const float a1 = s * (1.5f - xaFrac);
+                    row[xaInt + 1] += d * (a1 - a0);
+                    for (int xi = xaInt + 2; xi < xbInt - 1; ++xi) {
+                        row[xi] += d * s;
+                    }
+                    const float a2 = a1 + (xbInt - xaInt - 3) * s;
+                    row[xbInt - 1] += d * (1 - a2 - am);
+                }
+                row[xbInt] += d * am;
+                lastCell = xbInt;
+            }
+            fMinCell[r] = std::min(fMinCell[r], xaInt);
+            fMaxCell[r] = std::max(fMaxCell[r], lastCell);
+        }
+    }
+
+    float*      fAcc;
+    const int   fLeft;
+    const int   fWidth;
+    const int   fStride;
+    int         fTop, fHeight;
+    // The cells each row of the band has had lines add to
+    int         fMinCell[kMaxRows];
+    int         fMaxCell[kMaxRows];
+};
+
+#endif
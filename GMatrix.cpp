@@ -1,6 +1,11 @@
 #include "GMatrix.h" 
 #include "GPoint.h"
 #include <math.h> 
+#include <string.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
 
 // Everything is from Google Doc "Matrix"
 
@@ -35,10 +40,54 @@ bool GMatrix::invert(GMatrix* inverse) const{
     }
 }
 
+// One loop per matrix type. Each does the same float operations, in the same order, as the full
+// x' = SX*x + KX*y + TX (the terms it drops are exact zeros), so every type maps points identically.
 void GMatrix::mapPoints(GPoint dst[], const GPoint src[], int count) const{
-    for(int i = 0; i < count; i++){
-        float x = fMat[0] * src[i].fX + fMat[1] * src[i].fY + fMat[2];
-        float y = fMat[3] * src[i].fX + fMat[4] * src[i].fY + fMat[5];
-        dst[i] = {x, y};
+    const unsigned type = this->getType();
+    if(type == kIdentity_Mask){
+        if(dst != src){
+            memcpy(dst, src, count * sizeof(GPoint));
+        }
+        return;
+    }
+    int i = 0;
+#if defined(__SSE2__)
+    // Two points per register: x0 y0 x1 y1
+    const __m128 scale = _mm_setr_ps(fMat[SX], fMat[SY], fMat[SX], fMat[SY]);
+    const __m128 trans = _mm_setr_ps(fMat[TX], fMat[TY], fMat[TX], fMat[TY]);
+    if(type & kAffine_Mask){
+        const __m128 skew = _mm_setr_ps(fMat[KX], fMat[KY], fMat[KX], fMat[KY]);
+        for(; i + 2 <= count; i += 2){
+            __m128 p = _mm_loadu_ps(&src[i].fX);
+            __m128 swapped = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1));
+            p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p, scale), _mm_mul_ps(swapped, skew)), trans);
+            _mm_storeu_ps(&dst[i].fX, p);
+        }
+    }else if(type & kScale_Mask){
+        for(; i + 2 <= count; i += 2){
+            __m128 p = _mm_loadu_ps(&src[i].fX);
+            _mm_storeu_ps(&dst[i].fX, _mm_add_ps(_mm_mul_ps(p, scale), trans));
+        }
+    }else{
+        for(; i + 2 <= count; i += 2){
+            __m128 p = _mm_loadu_ps(&src[i].fX);
+            _mm_storeu_ps(&dst[i].fX, _mm_add_ps(p, trans));
+        }
+    }
+#endif
+    if(type & kAffine_Mask){
+        for(; i < count; i++){
+            float x = fMat[0] * src[i].fX + fMat[1] * src[i].fY + fMat[2];
+            float y = fMat[3] * src[i].fX + fMat[4] * src[i].fY + fMat[5];
+            dst[i] = {x, y};
+        }
+    }else if(type & kScale_Mask){
+        for(; i < count; i++){
+            dst[i] = {fMat[SX] * src[i].fX + fMat[TX], fMat[SY] * src[i].fY + fMat[TY]};
+        }
+    }else{
+        for(; i < count; i++){
+            dst[i] = {src[i].fX + fMat[TX], src[i].fY + fMat[TY]};
+        }
     }
 }
@@ -2,6 +2,7 @@
 #include <GRect.h>
 #include <GPoint.h>
 #include <GMatrix.h>
+#include <cmath>
 
 GPath& GPath::addRect(const GRect& rectangle, Direction direction){
 	GPoint a = {rectangle.fLeft, rectangle.fTop};
@@ -56,6 +57,92 @@ void GPath::transform(const GMatrix& matrix){
 	GMatrix copyMatrix = matrix;
 	GPoint* pointArray = fPts.data();
 	copyMatrix.mapPoints(pointArray, number);
+	this->invalidateConvexity();
+}
+
+bool GPath::isConvex(Direction* direction) const{
+	if(fConvexity == kUnknown_Convexity){
+		fConvexity = this->computeConvexity(&fDirection);
+	}
+	if(fConvexity == kConvex_Convexity && direction != nullptr){
+		*direction = fDirection;
+	}
+	return fConvexity == kConvex_Convexity;
+}
+
+// The points, closed back to the first, make a convex polygon when every turn from one step to the
+// next goes the same way, no step doubles back, and the steps' x and y each change sign at most
+// twice (so the turns go around once, not twice like a star's)
+GPath::Convexity GPath::computeConvexity(Direction* direction) const{
+	int verbCount = (int)fVbs.size();
+	if(verbCount == 0 || fVbs[0] != kMove){
+		return kConcave_Convexity;
+	}
+	for(int i = 1; i < verbCount; i++){
+		if(fVbs[i] == kMove){
+			return kConcave_Convexity;
+		}
+	}
+	int number = (int)fPts.size();
+	for(int i = 0; i < number; i++){
+		if(!std::isfinite(fPts[i].fX) || !std::isfinite(fPts[i].fY)){
+			return kConcave_Convexity;
+		}
+	}
+	// The first lap only finds the step (and signs) that lead into the first point
+	float turn = 0;
+	float lastX = 0;
+	float lastY = 0;
+	int lastSignX = 0;
+	int lastSignY = 0;
+	int flipsX = 0;
+	int flipsY = 0;
+	for(int i = 0; i < 2 * number; i++){
+		const GPoint& a = fPts[i % number];
+		const GPoint& b = fPts[(i + 1) % number];
+		float stepX = b.fX - a.fX;
+		float stepY = b.fY - a.fY;
+		if(stepX == 0 && stepY == 0){
+			continue;
+		}
+		int signX = (stepX > 0) - (stepX < 0);
+		int signY = (stepY > 0) - (stepY < 0);
+		if(i >= number){
+			// Curves' control points are often in line with their ends (a circle's lie on its
+			// tangents), so a turn too small to tell from rounding counts as straight
+			float cross = lastX * stepY - lastY * stepX;
+			float size = (fabsf(lastX) + fabsf(lastY)) * (fabsf(stepX) + fabsf(stepY));
+			if(fabsf(cross) > size * (1.0f / (1 << 16))){
+				if(turn != 0 && (cross > 0) != (turn > 0)){
+					return kConcave_Convexity;
+				}
+				turn = cross;
+			}else if(lastX * stepX + lastY * stepY < 0){
+				return kConcave_Convexity;
+			}
+			if(signX != 0 && lastSignX != 0 && signX != lastSignX){
+				flipsX++;
+			}
+			if(signY != 0 && lastSignY != 0 && signY != lastSignY){
+				flipsY++;
+			}
+		}
+		lastX = stepX;
+		lastY = stepY;
+		if(signX != 0){
+			lastSignX = signX;
+		}
+		if(signY != 0){
+			lastSignY = signY;
+		}
+	}
+	// All in a line (or a single point) has no inside
+	if(turn == 0 || flipsX > 2 || flipsY > 2){
+		return kConcave_Convexity;
+	}
+	// With y down, turning right is clockwise
+	*direction = turn > 0 ? kCW_Direction : kCCW_Direction;
+	return kConvex_Convexity;
 }
 
 
@@ -3,6 +3,9 @@
 #include "GBitmap.h"
 #include "GPixel.h"
 #include "GMath.h"
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
 
 
 class MyBitmapShader : public GShader {
@@ -15,63 +18,179 @@ public:
 		return this->myDevice.isOpaque();
 	}
 
-	bool setContext(const GMatrix& ctm) override {
-		GMatrix temp = fLocalMatrix;
-		fLocalMatrix.setConcat(ctm, fLocalMatrix);
-		if(!fLocalMatrix.invert(&fInverse)){
-			fLocalMatrix = temp;
-			return false;
-		} else {
-			fLocalMatrix = temp;
-			fInverse.postScale((float) 1 / this->myDevice.width(), (float) 1 / this->myDevice.height());
-			return true;
+	Context* makeContext(const GMatrix& ctm, GArena* arena) override {
+		GMatrix total;
+		total.setConcat(ctm, fLocalMatrix);
+		GMatrix inverse;
+		if(!total.invert(&inverse)){
+			return nullptr;
 		}
+		return arena->make<BitmapContext>(this->myDevice, inverse, fTileMode);
 	}
 
-	void shadeRow(int x, int y, int count, GPixel row[]) override {
-		// Compute local coordinates from device coordinates; we need to add 0.5 to x and y because of rounding issues
-		GPoint local = fInverse.mapXY(x + 0.5, y + 0.5);
-		for (int i = 0; i < count; ++i) {
-			float tileX = local.fX;
-			float tileY = local.fY;
-			if (fTileMode == GShader::kRepeat) { // repeat
-				tileX = tileX - GFloorToInt(tileX);
-				tileY = tileY - GFloorToInt(tileY);
-			}else if (fTileMode == GShader::kClamp) { // clamp
-				tileX = fmin(fmax(tileX, 0.0), 0.99999f);
-				tileY = fmin(fmax(tileY, 0.0), 0.99999f);
-			}else if (fTileMode == GShader::kMirror) { // mirror
-				tileX *= 0.5;
-				tileX = tileX - GFloorToInt(tileX);
-				if (tileX > 0.5) {
-					tileX = 1 - tileX;
+private:
+	// Tile an integer texel coordinate q into [0, size)
+	struct ClampTile {
+		int fMax;
+		ClampTile(int size) : fMax(size - 1) {}
+		int operator()(int q) const { return q < 0 ? 0 : (q > fMax ? fMax : q); }
+	};
+	struct RepeatTile {
+		int fSize;
+		RepeatTile(int size) : fSize(size) {}
+		int operator()(int q) const {
+			int r = q % fSize;
+			return r < 0 ? r + fSize : r;
+		}
+	};
+	struct RepeatPow2Tile {
+		int fMask;
+		RepeatPow2Tile(int size) : fMask(size - 1) {}
+		// two's complement makes the mask a floor-mod, negative q included
+		int operator()(int q) const { return q & fMask; }
+	};
+	struct MirrorTile {
+		int fSize;
+		MirrorTile(int size) : fSize(size) {}
+		int operator()(int q) const {
+			int r = q % (2 * fSize);
+			if (r < 0) {
+				r += 2 * fSize;
+			}
+			return r < fSize ? r : 2 * fSize - 1 - r;
+		}
+	};
+	struct MirrorPow2Tile {
+		int fSize;
+		MirrorPow2Tile(int size) : fSize(size) {}
+		// The size bit says which way this period runs; odd periods count down: ~q == -1 - q
+		int operator()(int q) const { return (q & fSize) ? (~q & (fSize - 1)) : (q & (fSize - 1)); }
+	};
+
+	class BitmapContext : public Context {
+	public:
+		BitmapContext(const GBitmap& device, const GMatrix& inverse, GShader::TileMode mode)
+			: myDevice(device), fInverse(inverse), fTileMode(mode) {}
+
+		void shadeRow(int x, int y, int count, GPixel row[]) const override {
+			const int w = this->myDevice.width();
+			const int h = this->myDevice.height();
+			if (fInverse.isTranslate() && fTileMode != GShader::kMirror) {
+				this->shadeTranslate(x, y, count, row);
+				return;
+			}
+			if (fTileMode == GShader::kClamp) { // clamp
+				this->shade(ClampTile(w), ClampTile(h), x, y, count, row);
+			} else if (fTileMode == GShader::kRepeat) { // repeat
+				if (IsPow2(w) && IsPow2(h)) {
+					this->shade(RepeatPow2Tile(w), RepeatPow2Tile(h), x, y, count, row);
+				} else {
+					this->shade(RepeatTile(w), RepeatTile(h), x, y, count, row);
+				}
+			} else { // mirror
+				if (IsPow2(w) && IsPow2(h)) {
+					this->shade(MirrorPow2Tile(w), MirrorPow2Tile(h), x, y, count, row);
+				} else {
+					this->shade(MirrorTile(w), MirrorTile(h), x, y, count, row);
+				}
+			}
+		}
+
+	private:
+		static bool IsPow2(int n) {
+			return (n & (n - 1)) == 0;
+		}
+
+		// Positions truncate toward -inf so that >> 32 floors them, steps round to nearest
+		static int64_t ToFixed(double v) {
+			return (int64_t) floor(v * 4294967296.0);
+		}
+
+		static int64_t ToFixedStep(double v) {
+			return (int64_t) floor(v * 4294967296.0 + 0.5);
+		}
+
+		// The texel position of pixel center (x, y) in 32.32 fixed point: the row's origin at
+		// device x = 0, mapped once in double, plus x rounded steps. A pixel depends only on its
+		// own x and y, so a row samples the same however it is split into calls.
+		void rowOrigin(int y, int64_t* fx, int64_t* fy) const {
+			*fx = ToFixed(fInverse[GMatrix::SX] * 0.5 + fInverse[GMatrix::KX] * (y + 0.5) + fInverse[GMatrix::TX]);
+			*fy = ToFixed(fInverse[GMatrix::KY] * 0.5 + fInverse[GMatrix::SY] * (y + 0.5) + fInverse[GMatrix::TY]);
+		}
+
+		// Step the texel position in fixed point (held in 64 bits so heavy minification can't
+		// overflow); the integer part, tiled, is the nearest-neighbor sample.
+		template <typename TileX, typename TileY>
+		void shade(TileX tileX, TileY tileY, int x, int y, int count, GPixel row[]) const {
+			const int64_t dx = ToFixedStep(fInverse[GMatrix::SX]);
+			const int64_t dy = ToFixedStep(fInverse[GMatrix::KY]);
+			int64_t fx, fy;
+			this->rowOrigin(y, &fx, &fy);
+			fx += (int64_t) x * dx;
+			fy += (int64_t) x * dy;
+			const char* pixels = (const char*) this->myDevice.pixels();
+			const size_t rowBytes = this->myDevice.rowBytes();
+			if (dy == 0) {
+				// Axis-aligned: the whole span reads from one source row
+				const GPixel* src = (const GPixel*) (pixels + tileY((int) (fy >> 32)) * rowBytes);
+				for (int i = 0; i < count; ++i) {
+					row[i] = src[tileX((int) (fx >> 32))];
+					fx += dx;
 				}
-				tileX *= 2;
+				return;
+			}
+			for (int i = 0; i < count; ++i) {
+				const GPixel* src = (const GPixel*) (pixels + tileY((int) (fy >> 32)) * rowBytes);
+				row[i] = src[tileX((int) (fx >> 32))];
+				fx += dx;
+				fy += dy;
+			}
+		}
 
-				tileY *= 0.5;
-				tileY = tileY - GFloorToInt(tileY);
-				if (tileY > 0.5) {
-					tileY = 1.0 - tileY;
+		// Only translated: the span's texels are consecutive texels of one row, each the one
+		// shade() would step to, so runs of them are copied straight from the bitmap
+		void shadeTranslate(int x, int y, int count, GPixel row[]) const {
+			const int w = this->myDevice.width();
+			const int h = this->myDevice.height();
+			int64_t fx, fy;
+			this->rowOrigin(y, &fx, &fy);
+			// SX is 1, so pixel x steps exactly one texel
+			const int q = (int) (fx >> 32) + x;
+			const int qy = (int) (fy >> 32);
+			const char* pixels = (const char*) this->myDevice.pixels();
+			const size_t rowBytes = this->myDevice.rowBytes();
+			if (fTileMode == GShader::kClamp) {
+				const GPixel* src = (const GPixel*) (pixels + ClampTile(h)(qy) * rowBytes);
+				// Left of the bitmap, then on it, then right of it
+				int i = (int) std::min<int64_t>(count, std::max<int64_t>(0, -(int64_t) q));
+				std::fill(row, row + i, src[0]);
+				if ((int64_t) q + i < w) {
+					int n = (int) std::min<int64_t>(count - i, w - ((int64_t) q + i));
+					memcpy(row + i, src + q + i, n * sizeof(GPixel));
+					i += n;
 				}
-				tileY *= 2;
+				std::fill(row + i, row + count, src[w - 1]);
+				return;
 			}
-				// Adjust to bitmap size
-				tileX *= this->myDevice.width();
-				tileY *= this->myDevice.height();
-				// Find the colors by local coordinates
-				row[i] = *this->myDevice.getAddr(GFloorToInt(tileX), GFloorToInt(tileY));
-				local.fX += fInverse[GMatrix::SX];
-				local.fY += fInverse[GMatrix::KY];
+			const GPixel* src = (const GPixel*) (pixels + RepeatTile(h)(qy) * rowBytes);
+			int texel = RepeatTile(w)(q);
+			for (int i = 0; i < count;) {
+				int n = std::min(count - i, w - texel);
+				memcpy(row + i, src + texel, n * sizeof(GPixel));
+				i += n;
+				texel = 0;
 			}
 		}
 
+		const GBitmap myDevice;
+		// Final inverse: device space to the pixels of the bitmap
+		const GMatrix fInverse;
+		const GShader::TileMode fTileMode;
+	};
 
-private:
 	const GBitmap myDevice;
-	GMatrix fLocalMatrix;
-	// Final inverse; fInverse is a private matrix stored in MyShader.
-	GMatrix fInverse;
-	GShader::TileMode fTileMode;
+	const GMatrix fLocalMatrix;
+	const GShader::TileMode fTileMode;
 
 };
 
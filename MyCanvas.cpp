@@ -8,22 +8,74 @@
 #include "Edges.h"
 #include "GMatrix.h"
 #include "GShader.h"
+#include "GArena.h"
 #include "GBlendMode.h"
 #include "GPath.h"
+#include "BlendRow.h"
+#include "Coverage.h"
+#include "PathMaskCache.h"
+#include "ThreadPool.h"
 #include "math.h"
 #include <vector>
+#include <deque>
 #include <algorithm>
 #include <iterator>
 #include <iostream>
-#include "ProxyShader.cpp"
-#include "TriColorShader.cpp"
-#include "ComposeShader.cpp"
 
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
 
 
+
+// Shaded spans are shaded and blended this many pixels at a time, through one buffer that stays
+// in L1 however wide the span is. Build with -DG_SHADE_CHUNK=n to tune it.
+#ifndef G_SHADE_CHUNK
+#define G_SHADE_CHUNK 128
+#endif
+
+// Each canvas keeps up to this many bytes of rasterized path masks, reused while the same paths
+// are drawn under the same CTM. Build with -DG_PATH_MASK_CACHE_BYTES=0 to draw every path directly.
+#ifndef G_PATH_MASK_CACHE_BYTES
+#define G_PATH_MASK_CACHE_BYTES (4 << 20)
+#endif
+
+static PathMaskCache::Counters gPathMaskCounters;
+
+// Any canvas can draw a bitmap as a rect filled with it
+void GCanvas::drawBitmap(const GBitmap& bitmap, float x, float y, const GPaint& paint) {
+    std::unique_ptr<GShader> shader = GCreateBitmapShader(bitmap, GMatrix::MakeTranslate(x, y));
+    if(shader == nullptr){
+        return;
+    }
+    GPaint bitmapPaint = paint;
+    bitmapPaint.setShader(shader.get());
+    this->drawRect(GRect::MakeXYWH(x, y, bitmap.width(), bitmap.height()), bitmapPaint);
+}
+
 class MyCanvas : public GCanvas {
 public:
-    MyCanvas(const GBitmap& device) : fDevice(device) {} // pass a parameter to the superclass constructor
+    enum {
+        kShadeChunk = G_SHADE_CHUNK,
+        // buffers start on a cache line
+        kBufferAlign = 64,
+        // empty or fully covered runs shorter than this are drawn along with the partial pixels
+        kMinCoverageRun = 16,
+    };
+    static const size_t kMaskCacheBytes = G_PATH_MASK_CACHE_BYTES;
+
+    MyCanvas(const GBitmap& device) : fDevice(device), fClipTop(0), fClipBottom(device.height()), fMaskCache(kMaskCacheBytes, &gPathMaskCounters) {} // pass a parameter to the superclass constructor
+
+    // Only rows in [top, bottom) are written. Geometry is still computed against the whole device,
+    // so every row that is drawn comes out exactly as it would without the restriction.
+    void setClipRows(int top, int bottom) {
+        fClipTop = std::max(top, 0);
+        fClipBottom = std::min(bottom, this->fDevice.height());
+    }
+
+    void setMatrix(const GMatrix& matrix) {
+        ctm = matrix;
+    }
 
     // layer list
     std::vector<GMatrix> ctmList;
@@ -45,35 +97,19 @@ public:
         ctm.setConcat(ctm, matrix);
     }
 
-    static void resortBackwards(int edgeIndex, std::vector<Edges> &edges){
-        if(edgeIndex <= 0){
-            return;
-        }
-        for(int i = edgeIndex; i > 0; i--){
-            for(int j = edgeIndex; j > edgeIndex - i; j--){
-                if(edges[j].currentX < edges[j - 1].currentX){
-                    Edges temp = edges[j];
-                    edges[j] = edges[j - 1];
-                    edges[j - 1] = temp;
-                }
-            }
-        }
-    }
-
-
     // find minY and maxY in E
-    static int FindMinY(const std::vector<Edges>& edge){
+    static int FindMinY(const Edges edge[], int count){
         int minY = edge[0].topY;
-        for(int i = 1; i < edge.size(); i++){
+        for(int i = 1; i < count; i++){
             if(edge[i].topY < minY){
                 minY = edge[i].topY;
             }
         }
         return minY;
     }
-    static int FindMaxY(const std::vector<Edges>& edge){
+    static int FindMaxY(const Edges edge[], int count){
         int maxY = edge[0].bottomY;
-        for(int i = 1; i < edge.size(); i++){
+        for(int i = 1; i < count; i++){
             if(edge[i].bottomY > maxY){
                 maxY = edge[i].bottomY;
             }
@@ -93,134 +129,77 @@ public:
         return GPixel_PackARGB(a, r, g, b);
     }
 
-    // turn 0xAABBCCDD into 0x00AA00CC00BB00DD
-    static uint64_t expand(uint32_t x) {
-        uint64_t hi = x & 0xFF00FF00;  // the A and G components
-        uint64_t lo = x & 0x00FF00FF;// the R and B components
-        return (hi << 24) | lo;
-    }
-
-    // turn 0xXX into 0x00XX00XX00XX00XX
-    static uint64_t replicate(uint64_t x) {
-        return (x << 48) | (x << 32) | (x << 16) | x;
-    }
-
-    // turn 0x..AA..CC..BB..DD into 0xAABBCCDD
-    static uint32_t compact(uint64_t x) {
-        return ((x >> 24) & 0xFF00FF00) | (x & 0xFF00FF);
-    }
-
-    static uint32_t quad_mul_div255(uint32_t x, uint8_t invA) {
-        uint64_t prod = expand(x) * invA;
-        prod += replicate(128);
-        prod += (prod >> 8) & replicate(0xFF);
-        prod >>= 8;
-        return compact(prod);
-    }
-
-    static unsigned div255(unsigned x) {
-        x += 128;
-        return x + (x >> 8) >> 8;
-    }
-
-
-    // Define a new type BlendProc and create blend function pointer
-    typedef GPixel (* BlendProc)(GPixel, GPixel);
-    const BlendProc blend_array[12] = {&Clear, &Source, &Destination, &SourceOver, &DestinationOver, &SourceIn, &DestinationIn, &SourceOut, &DestinationOut, &SourceAtTop, &DestinationAtTop, &Xor};
-
-    // Blend functions
-    static GPixel Clear(GPixel source, GPixel destination) {
-        return 0;
-    }
-
-    static GPixel Source(GPixel source, GPixel destination) {
-        return source;
-    }
-
-    static GPixel Destination(GPixel source, GPixel destination) {
-        return destination;
-    }
-
-    static GPixel SourceOver(GPixel source, GPixel destination) {
-        int sourceAlpha = GPixel_GetA(source);
-        return source + quad_mul_div255(destination, 255 - sourceAlpha);
-    }
-
-    static GPixel DestinationOver(GPixel source, GPixel destination) {
-        int destAlpha = GPixel_GetA(destination);
-        return destination + quad_mul_div255(source, 255 - destAlpha);
-    }
-
-    static GPixel SourceIn(GPixel source, GPixel destination) {
-        int destAlpha = GPixel_GetA(destination);
-        return quad_mul_div255(source, destAlpha);
-    }
-
-    static GPixel DestinationIn(GPixel source, GPixel destination) {
-        int sourceAlpha = GPixel_GetA(source);
-        return quad_mul_div255(destination, sourceAlpha);
-    }
-
-    static GPixel SourceOut(GPixel source, GPixel destination) {
-        int destAlpha = GPixel_GetA(destination);
-        return quad_mul_div255(source, 255 - destAlpha);
-    }
-
-    static GPixel DestinationOut(GPixel source, GPixel destination) {
-        int sourceAlpha = GPixel_GetA(source);
-        return quad_mul_div255(destination, 255 - sourceAlpha);
-    }
-
-    static GPixel SourceAtTop(GPixel source, GPixel destination) {
-        int sourceAlpha = GPixel_GetA(source);
-        int destAlpha = GPixel_GetA(destination);
-        return quad_mul_div255(source, destAlpha) + quad_mul_div255(destination, 255 - sourceAlpha);
-    }
-
-    static GPixel DestinationAtTop(GPixel source, GPixel destination) {
-        int sourceAlpha = GPixel_GetA(source);
-        int destAlpha = GPixel_GetA(destination);
-        return quad_mul_div255(source, 255 - destAlpha)
-               + quad_mul_div255(destination, sourceAlpha);
-    }
+    // How one draw writes its spans, picked once per draw from the blend mode, the source's
+    // opacity and whether there is a shader
+    struct Blitter {
+        GPixel                  fColor;
+        BlendRowConstProc       fConstProc;
+        // Only set when the source has to be shaded; a null fProc shades straight into dst
+        const GShader::Context* fContext;
+        BlendRowProc            fProc;
+        // kShadeChunk pixels for the shaded source, when it has to be blended
+        GPixel*                 fStorage;
+    };
 
-    static GPixel Xor(GPixel source, GPixel destination) {
-        int sourceAlpha = GPixel_GetA(source);
-        int destAlpha = GPixel_GetA(destination);
-        return quad_mul_div255(source, 255 - destAlpha) + quad_mul_div255(destination, 255 - sourceAlpha);
+    // Pick the blitter for one draw, making any shader context in fArena. Returns false if the
+    // draw can't change a pixel (or the shader can't draw with the CTM): draw nothing.
+    bool makeBlitter(const GPaint& paint, Blitter* blitter) {
+        GShader* shader = paint.getShader();
+        GBlendMode mode;
+        if(shader == nullptr){
+            blitter->fColor = this->convertSColor(paint.getColor());
+            int alpha = GPixel_GetA(blitter->fColor);
+            mode = reduceBlendMode(paint.getBlendMode(), alpha == 0xFF, alpha == 0);
+        }else{
+            blitter->fColor = 0;
+            mode = reduceBlendMode(paint.getBlendMode(), shader->isOpaque(), false);
+        }
+        if(mode == GBlendMode::kDst){
+            return false;
+        }
+        blitter->fConstProc = gBlendRowConstProcs[static_cast<int>(mode)];
+        blitter->fContext = nullptr;
+        blitter->fProc = nullptr;
+        blitter->fStorage = nullptr;
+        // Clear doesn't need to know what the shader would have drawn
+        if(shader != nullptr && mode != GBlendMode::kClear){
+            blitter->fContext = shader->makeContext(ctm, &fArena);
+            if(blitter->fContext == nullptr){
+                return false;
+            }
+            if(mode != GBlendMode::kSrc){
+                blitter->fProc = gBlendRowProcs[static_cast<int>(mode)];
+                blitter->fStorage = fArena.makeArray<GPixel>(kShadeChunk, kBufferAlign);
+            }
+        }
+        return true;
     }
 
-
     // Blit function for the polygon
-    void blit(int y, int leftX, int rightX, const GPaint& paint) {
-        GPixel source = this->convertSColor(paint.getColor());
-        BlendProc blender = blend_array[static_cast<int>(paint.getBlendMode())]; // Initialize a blender type object
-        for (int x = leftX; x < rightX; x++) {
-            GPixel* address = this->fDevice.getAddr(x, y);
-            GPixel destination = *address;
-            GPixel resultColor = blender(source, destination);
-            *address = resultColor;
+    void blit(int y, int leftX, int rightX, const Blitter& blitter) {
+        if (rightX <= leftX) {
+            return;
         }
+        this->blitRow(this->fDevice.getAddr(leftX, y), leftX, y, rightX - leftX, blitter);
     }
 
-    // blit_shadeRow function
-    void blit_shadeRow(int y, int leftX, int rightX, const GPaint& paint) {
-        BlendProc proc = blend_array[static_cast<int>(paint.getBlendMode())];
-        // Source
-        GPixel storage[rightX - leftX];
-        paint.getShader()->shadeRow(leftX, y, rightX - leftX, storage);
-
-        int sourceIndex = 0;
-        for(int x = leftX; x < rightX; x++){
-            GPixel* address = this->fDevice.getAddr(x, y); // destination already present in the device’s bitmap
-            GPixel destination = *address;
-            GPixel resultColor = proc(storage[sourceIndex], destination); // call blend by pointer
-            *address = resultColor; // change the value pointed by address
-            sourceIndex += 1;
+    // Draw count pixels of row y, starting at leftX, into dst
+    void blitRow(GPixel dst[], int leftX, int y, int count, const Blitter& blitter) {
+        if (blitter.fContext == nullptr) {
+            blitter.fConstProc(dst, blitter.fColor, count);
+        } else if (blitter.fProc == nullptr) {
+            blitter.fContext->shadeRow(leftX, y, count, dst);
+        } else {
+            // Shade the source a chunk at a time and blend it against the destination already
+            // present in the device's bitmap
+            for (int x = 0; x < count; x += kShadeChunk) {
+                int n = std::min(count - x, (int)kShadeChunk);
+                blitter.fContext->shadeRow(leftX + x, y, n, blitter.fStorage);
+                blitter.fProc(dst + x, blitter.fStorage, n);
+            }
         }
     }
 
-
     // sort function
     static GPoint SortYTop(const GPoint &top, const GPoint &bottom){
         if(top.fY < bottom.fY){
@@ -252,7 +231,8 @@ public:
     }
 
     // clipping function
-    void Clip(const GPoint &topPoint, const GPoint &botPoint, std::vector<Edges> &edge){
+    // Adds at most 3 edges
+    void Clip(const GPoint &topPoint, const GPoint &botPoint, GArenaArray<Edges> &edge){
         int a = 1;
         if(topPoint.fY == botPoint.fY){
             return;
@@ -269,6 +249,22 @@ public:
         int rightX = this->fDevice.width();
         float m = (botPointY.fX - topPointY.fX)/(botPointY.fY - topPointY.fY);
 
+        // Most segments are inside the device, where none of the chopping below applies: go
+        // straight to the edge the last case would make
+        if(topPointY.fY >= topY && botPointY.fY <= botY
+           && std::min(topPointY.fX, botPointY.fX) >= leftX
+           && std::max(topPointY.fX, botPointY.fX) <= rightX
+           && std::min(topPointY.fX, botPointY.fX) < rightX
+           && std::max(topPointY.fX, botPointY.fX) > leftX){
+            int roundTopY = GRoundToInt(topPointY.fY);
+            int roundBotY = GRoundToInt(botPointY.fY);
+            if(roundTopY != roundBotY){
+                double currentX = topPointY.fX + m * (roundTopY - topPointY.fY + 0.5);
+                edge.push_back(Edges(roundTopY, roundBotY, currentX, m, a));
+            }
+            return;
+        }
+
         // Return if completely above or below the bitmap
         if(botPointY.fY <= topY || topPointY.fY >= botY){
             return;
@@ -323,7 +319,7 @@ public:
             int roundTopPointLR = GRoundToInt(topPointLR.fY);
             int roundBotPointLR = GRoundToInt(botPointLR.fY);
             if(roundTopPointLR != roundBotPointLR){
-                float currentX = topPointLR.fX + m * (roundTopPointLR - topPointLR.fY + 0.5);
+                double currentX = topPointLR.fX + m * (roundTopPointLR - topPointLR.fY + 0.5);
                 edge.push_back(Edges(roundTopPointLR, roundBotPointLR, currentX, m, a));
             }
         }else if(leftPointX.fX < leftX && rightPointX.fX > rightX) {
@@ -351,7 +347,7 @@ public:
             int rounTopPointLR = GRoundToInt(topPointLR.fY);
             int rountBotPointLR = GRoundToInt(botPointLR.fY);
             if (rounTopPointLR != rountBotPointLR) {
-                float currentX = topPointLR.fX + m * (rounTopPointLR - topPointLR.fY + 0.5);
+                double currentX = topPointLR.fX + m * (rounTopPointLR - topPointLR.fY + 0.5);
                 edge.push_back(Edges(rounTopPointLR, rountBotPointLR, currentX, m, a));
             }
         }else if(leftPointX.fX >= leftX && rightPointX.fX > rightX){
@@ -371,7 +367,7 @@ public:
             int roundTopPointLR1 = GRoundToInt(topPointLR0.fY);
             int roundBotPointLR1 = GRoundToInt(botPointLR0.fY);
             if(roundTopPointLR1 != roundBotPointLR1){
-                float currentX = topPointLR0.fX + m * (roundTopPointLR1 - topPointLR0.fY + 0.5);
+                double currentX = topPointLR0.fX + m * (roundTopPointLR1 - topPointLR0.fY + 0.5);
                 edge.push_back(Edges(roundTopPointLR1, roundBotPointLR1, currentX, m, a));
             }
         }else{
@@ -380,7 +376,7 @@ public:
             int roundTopPointLR = GRoundToInt(topPointLR.fY);
             int roundBotPointLR = GRoundToInt(botPointLR.fY);
             if(roundTopPointLR != roundBotPointLR){
-                float currentX = topPointLR.fX + m * (roundTopPointLR - topPointLR.fY + 0.5);
+                double currentX = topPointLR.fX + m * (roundTopPointLR - topPointLR.fY + 0.5);
                 edge.push_back(Edges(roundTopPointLR, roundBotPointLR, currentX, m, a));
             }
         }
@@ -388,58 +384,423 @@ public:
 
 
 
+    // drawPath's edges: Clip's edges for lines that reach outside the device, and the chains
+    // that lines inside it are gathered into, each of which walkEdges steps as one edge
+    struct PathEdges {
+        PathEdges(GArena* arena) : fEdges(arena), fChains(arena), fPoints(arena) {}
+
+        GArenaArray<Edges>      fEdges;
+        GArenaArray<EdgeChain>  fChains;
+        GArenaArray<GPoint>     fPoints;
+        // The chain being gathered: fPoints[fRunStart...] heading fRunDir in y (0 while it has
+        // only been flat), or fRunStart < 0 for none
+        int                     fRunStart = -1;
+        int                     fRunDir = 0;
+    };
+
+    // Add one device-space line of a path. A line inside the device that starts where the
+    // last one ended, heading the same way in y, extends the current chain.
+    void addPathLine(GPoint p0, GPoint p1, PathEdges& edges) {
+        const float width = this->fDevice.width();
+        const float height = this->fDevice.height();
+        if(!(p0.fX >= 0 && p0.fX <= width && p0.fY >= 0 && p0.fY <= height
+             && p1.fX >= 0 && p1.fX <= width && p1.fY >= 0 && p1.fY <= height)){
+            CloseChain(edges);
+            Clip(p0, p1, edges.fEdges);
+            return;
+        }
+        const int dir = p1.fY > p0.fY ? 1 : (p1.fY < p0.fY ? -1 : 0);
+        if(edges.fRunStart >= 0 && edges.fPoints[edges.fPoints.size() - 1] == p0
+           && (dir == 0 || edges.fRunDir == 0 || dir == edges.fRunDir)){
+            edges.fPoints.push_back(p1);
+            if(edges.fRunDir == 0){
+                edges.fRunDir = dir;
+            }
+            return;
+        }
+        CloseChain(edges);
+        edges.fRunStart = edges.fPoints.size();
+        edges.fRunDir = dir;
+        edges.fPoints.push_back(p0);
+        edges.fPoints.push_back(p1);
+    }
+
+    // Finish the chain being gathered: its top line with rows goes in fEdges
+    static void CloseChain(PathEdges& edges) {
+        if(edges.fRunStart < 0){
+            return;
+        }
+        const int first = edges.fRunStart;
+        const int last = edges.fPoints.size() - 1;
+        edges.fRunStart = -1;
+        EdgeChain chain;
+        if(edges.fRunDir >= 0){
+            chain = {first, last, 1, 0};
+        }else{
+            chain = {last, first, -1, 0};
+        }
+        Edges head(0, 0, 0, 0, 0);
+        if(!NextChainEdge(chain, edges.fPoints.data(), &head)){
+            return;
+        }
+        // Each line's rows start where the ones of the line above it stop, so the chain ends
+        // at its bottom-most point
+        chain.fBottomY = GRoundToInt(edges.fPoints[edges.fRunDir >= 0 ? last : first].fY);
+        if(chain.fNext == chain.fEnd){
+            // Only one line has rows: no need for a chain
+            edges.fEdges.push_back(head);
+            return;
+        }
+        head.fChain = edges.fChains.size();
+        edges.fChains.push_back(chain);
+        edges.fEdges.push_back(head);
+    }
+
+    // Set *edge to the chain's next line that has rows, exactly the edge Clip would make of it,
+    // and move past that line. Returns false when the chain has none left.
+    static bool NextChainEdge(EdgeChain& chain, const GPoint points[], Edges* edge) {
+        while(chain.fNext != chain.fEnd){
+            const GPoint& top = points[chain.fNext];
+            const GPoint& bot = points[chain.fNext + chain.fStep];
+            chain.fNext += chain.fStep;
+            if(top.fY == bot.fY){
+                continue;
+            }
+            int roundTopY = GRoundToInt(top.fY);
+            int roundBotY = GRoundToInt(bot.fY);
+            if(roundTopY != roundBotY){
+                float m = (bot.fX - top.fX)/(bot.fY - top.fY);
+                edge->topY = roundTopY;
+                edge->bottomY = roundBotY;
+                edge->currentX = EdgeFixed(top.fX + m * (roundTopY - top.fY + 0.5));
+                edge->slope = EdgeFixed(m);
+                // Clip's winding: -1 going down the path
+                edge->fW = chain.fStep > 0 ? -1 : 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
     void drawPaint(const GPaint& paint) override {
+        GArenaScope scope(&fArena);
+        Blitter blitter;
+        // If the shader fails, or the paint can't change anything, return with nothing
+        if(!makeBlitter(paint, &blitter)){
+            return;
+        }
         int leftX = 0;
         int rightX = this->fDevice.width();
-        for(int y = 0; y < this->fDevice.height(); y++){
-            if(paint.getShader() == nullptr){
-                blit(y, leftX, rightX, paint);
-            }else{
-                // If the shader fails, return with nothing
-                if (!paint.getShader()->setContext(ctm)) {
-                    return;
-                }
-                blit_shadeRow(y, leftX, rightX, paint);
-           }
+        for(int y = fClipTop; y < fClipBottom; y++){
+            blit(y, leftX, rightX, blitter);
         }
     }
 
 
     void drawRect(const GRect& rect, const GPaint& paint) override {
-        BlendProc blender = blend_array[static_cast<int>(paint.getBlendMode())]; // blend function pointer
-        if(paint.getShader() != nullptr){
-            if (!paint.getShader()->setContext(ctm)) {
+        if(ctm.isScaleTranslate() && !paint.isAntiAlias()){
+            GPoint corners[2] = {{rect.fLeft, rect.fTop}, {rect.fRight, rect.fBottom}};
+            ctm.mapPoints(corners, 2);
+            if(std::isfinite(corners[0].fX + corners[0].fY + corners[1].fX + corners[1].fY)){
+                fillAxisAlignedRect(GRect::MakeLTRB(std::min(corners[0].fX, corners[1].fX),
+                                                    std::min(corners[0].fY, corners[1].fY),
+                                                    std::max(corners[0].fX, corners[1].fX),
+                                                    std::max(corners[0].fY, corners[1].fY)), paint);
                 return;
-            } // If the shader fails, return with nothing
-            GPoint p1 = {rect.fLeft, rect.fTop};
-            GPoint p2 = {rect.fRight, rect.fTop};
-            GPoint p3 = {rect.fRight, rect.fBottom};
-            GPoint p4 = {rect.fLeft, rect.fBottom};
-            GPoint rect_points[4] = { p1, p2, p3, p4};
-            drawConvexPolygon(rect_points, 4, paint);
-        }else{
-            GPoint p1 = {rect.fLeft, rect.fTop};
-            GPoint p2 = {rect.fRight, rect.fTop};
-            GPoint p3 = {rect.fRight, rect.fBottom};
-            GPoint p4 = {rect.fLeft, rect.fBottom};
-            GPoint rect_points[4] = { p1, p2, p3, p4};
-            drawConvexPolygon(rect_points, 4, paint);
+            }
+        }
+        GPoint p1 = {rect.fLeft, rect.fTop};
+        GPoint p2 = {rect.fRight, rect.fTop};
+        GPoint p3 = {rect.fRight, rect.fBottom};
+        GPoint p4 = {rect.fLeft, rect.fBottom};
+        GPoint rect_points[4] = { p1, p2, p3, p4};
+        drawConvexPolygon(rect_points, 4, paint);
+    }
+
+    // Fill a sorted device-space rect with the pixels drawConvexPolygon would: pixel centers
+    // are in when they round inside the edges (x as the edges' fixed point does), and (as there) the
+    // last column is never reached
+    void fillAxisAlignedRect(const GRect& rect, const GPaint& paint) {
+        const int width = this->fDevice.width();
+        const int height = this->fDevice.height();
+        // Pin to the device first, so the rounding can't overflow
+        auto pin = [](float v, int max){ return std::max(0.0f, std::min(v, (float) max)); };
+        const int leftX = std::min(EdgeRound(EdgeFixed(pin(rect.fLeft, width))), width - 1);
+        const int rightX = std::min(EdgeRound(EdgeFixed(pin(rect.fRight, width))), width - 1);
+        const int top = std::max(GRoundToInt(pin(rect.fTop, height)), fClipTop);
+        const int bottom = std::min(GRoundToInt(pin(rect.fBottom, height)), fClipBottom);
+        if(leftX >= rightX || top >= bottom){
+            return;
+        }
+        GArenaScope scope(&fArena);
+        Blitter blitter;
+        if(!makeBlitter(paint, &blitter)){
+            return;
+        }
+        if(blitter.fContext != nullptr && blitter.fContext->isRowInvariant()){
+            // Every row gets the same source: shade it once, in blitRow's chunks
+            const int count = rightX - leftX;
+            GPixel* src = fArena.makeArray<GPixel>(count, kBufferAlign);
+            for(int x = 0; x < count; x += kShadeChunk){
+                blitter.fContext->shadeRow(leftX + x, top, std::min(count - x, (int)kShadeChunk),
+                                           src + x);
+            }
+            for(int y = top; y < bottom; y++){
+                GPixel* dst = this->fDevice.getAddr(leftX, y);
+                if(blitter.fProc == nullptr){
+                    memcpy(dst, src, count * sizeof(GPixel));
+                }else{
+                    blitter.fProc(dst, src, count);
+                }
+            }
+            return;
+        }
+        for(int y = top; y < bottom; y++){
+            blit(y, leftX, rightX, blitter);
+        }
+    }
+
+    void drawBitmap(const GBitmap& bitmap, float x, float y, const GPaint& paint) override {
+        if(ctm.isTranslate()){
+            // On whole pixels every device pixel center lands on a texel center
+            GPoint origin = ctm.mapXY(x, y);
+            const float limit = 1 << 24;
+            if(origin.fX == floorf(origin.fX) && origin.fY == floorf(origin.fY)
+               && fabsf(origin.fX) < limit && fabsf(origin.fY) < limit){
+                blitBitmap(bitmap, (int) origin.fX, (int) origin.fY, paint);
+                return;
+            }
+        }
+        GCanvas::drawBitmap(bitmap, x, y, paint);
+    }
+
+    // Copy or blend the bitmap's rows straight into the device, its top-left at pixel (x, y),
+    // covering the pixels the shaded rect would
+    void blitBitmap(const GBitmap& bitmap, int x, int y, const GPaint& paint) {
+        const int width = this->fDevice.width();
+        // Anti-aliased rects reach the last column; aliased ones, as in fillAxisAlignedRect, don't
+        const int left = std::max(x, 0);
+        const int right = std::min(x + bitmap.width(), paint.isAntiAlias() ? width : width - 1);
+        const int top = std::max(y, fClipTop);
+        const int bottom = std::min(y + bitmap.height(), fClipBottom);
+        if(left >= right || top >= bottom || bitmap.pixels() == nullptr){
+            return;
+        }
+        const GBlendMode mode = reduceBlendMode(paint.getBlendMode(), bitmap.isOpaque(), false);
+        if(mode == GBlendMode::kDst){
+            return;
+        }
+        const int count = right - left;
+        for(int row = top; row < bottom; row++){
+            GPixel* dst = this->fDevice.getAddr(left, row);
+            const GPixel* src = bitmap.getAddr(left - x, row - y);
+            if(mode == GBlendMode::kSrc){
+                memcpy(dst, src, count * sizeof(GPixel));
+            }else if(mode == GBlendMode::kClear){
+                gBlendRowConstProcs[static_cast<int>(mode)](dst, 0, count);
+            }else{
+                gBlendRowProcs[static_cast<int>(mode)](dst, src, count);
+            }
         }
     }
 
     void drawPath(const GPath& path, const GPaint& paint) override {
-        // Map path by ctm
-        GPath copyPath = path;
-        copyPath.transform(ctm);
+        const GRect bounds = deviceBounds(path);
+        if(quickReject(bounds)){
+            return;
+        }
+        if(drawPathMask(path, paint)){
+            return;
+        }
+        const int width = this->fDevice.width();
+        const int height = this->fDevice.height();
+        if(paint.isAntiAlias()){
+            GArenaScope scope(&fArena);
+            GArenaArray<GPoint> segments(&fArena);
+            FlattenPath(path, ctm, width, height, kOffRows_CurveCull, [&](GPoint p0, GPoint p1){
+                segments.push_back(p0);
+                segments.push_back(p1);
+            });
+            fillAntiAliased(bounds, segments, paint);
+            return;
+        }
+        GArenaScope scope(&fArena);
+        PathEdges edges(&fArena);
+        FlattenPath(path, ctm, width, height, kOffColumns_CurveCull,
+                    [&](GPoint p0, GPoint p1){ addPathLine(p0, p1, edges); });
+        CloseChain(edges);
+        if(edges.fEdges.empty() == false){
+            fillEdges(edges, path.isConvex(), paint);
+        }
+    }
+
+    // Draw the path from its mask in fMaskCache. A mask is only rasterized for a path that has
+    // missed before, and holds just the clip rows, so a band of a tiled canvas pays for its own
+    // rows only. Returns false when the path should be drawn directly.
+    bool drawPathMask(const GPath& path, const GPaint& paint) {
+        if(kMaskCacheBytes == 0){
+            return false;
+        }
+        PathMaskKey key;
+        key.fPathHash = PathMaskKey::HashPath(path);
+        for(int i = 0; i < 6; i++){
+            key.fMatrix[i] = ctm[i];
+        }
+        key.fAntiAlias = paint.isAntiAlias();
+        key.fTop = fClipTop;
+        key.fBottom = fClipBottom;
+        const PathMask* mask = fMaskCache.find(key, path);
+        if(mask == nullptr){
+            if(!fMaskCache.missedBefore(key)){
+                return false;
+            }
+            rasterizeMask(path, paint.isAntiAlias(), &fScratchMask);
+            mask = fMaskCache.add(key, path, fScratchMask);
+            if(mask == nullptr){
+                mask = &fScratchMask;
+            }
+        }
+        drawMask(*mask, paint);
+        return true;
+    }
+
+    // The spans of the path under ctm, on the clip rows, into mask
+    void rasterizeMask(const GPath& path, bool antiAlias, PathMask* mask) {
+        mask->reset();
+        GArenaScope scope(&fArena);
+        const int width = this->fDevice.width();
+        const int height = this->fDevice.height();
+        if(antiAlias){
+            const GRect bounds = deviceBounds(path);
+            float left = std::max(bounds.fLeft, 0.0f);
+            float top = std::max(bounds.fTop, (float) fClipTop);
+            float right = std::min(bounds.fRight, (float) this->fDevice.width());
+            float bottom = std::min(bounds.fBottom, (float) fClipBottom);
+            if(!(left < right && top < bottom)){
+                return;
+            }
+            const int leftX = GFloorToInt(left);
+            GArenaArray<GPoint> segments(&fArena);
+            FlattenPath(path, ctm, width, height, kOffRows_CurveCull, [&](GPoint p0, GPoint p1){
+                segments.push_back(p0);
+                segments.push_back(p1);
+            });
+            resolveCoverage(segments, leftX, GFloorToInt(top), GCeilToInt(right) - leftX,
+                            GCeilToInt(bottom), [&](int y, int x, int end, const uint8_t coverage[]){
+                ForEachCoverageRun(coverage, x, end, [&](int l, int r){
+                    mask->fSpans.push_back({y, leftX + l, leftX + r, -1});
+                }, [&](int l, int r){
+                    mask->fSpans.push_back({y, leftX + l, leftX + r, (int) mask->fCoverage.size()});
+                    mask->fCoverage.insert(mask->fCoverage.end(), coverage + l, coverage + r);
+                });
+            });
+            return;
+        }
+        PathEdges edges(&fArena);
+        FlattenPath(path, ctm, width, height, kOffColumns_CurveCull,
+                    [&](GPoint p0, GPoint p1){ addPathLine(p0, p1, edges); });
+        CloseChain(edges);
+        if(edges.fEdges.empty() == false){
+            scanEdges(edges, path.isConvex(), fClipTop, fClipBottom,
+                      [&](int y, int leftX, int rightX){
+                if(leftX < rightX){
+                    mask->fSpans.push_back({y, leftX, rightX, -1});
+                }
+            });
+        }
+    }
+
+    // Draw the mask's spans in the clip rows
+    void drawMask(const PathMask& mask, const GPaint& paint) {
+        // Spans are sorted by row: start at the first one in the clip rows
+        auto span = std::lower_bound(mask.fSpans.begin(), mask.fSpans.end(), fClipTop,
+                                     [](const PathMask::Span& s, int y){ return s.fY < y; });
+        if(span == mask.fSpans.end() || span->fY >= fClipBottom){
+            return;
+        }
+        GArenaScope scope(&fArena);
+        Blitter blitter;
+        if(!makeBlitter(paint, &blitter)){
+            return;
+        }
+        GPixel* blended = nullptr;
+        if(mask.fCoverage.empty() == false){
+            blended = fArena.makeArray<GPixel>(kShadeChunk, kBufferAlign);
+        }
+        for(; span != mask.fSpans.end() && span->fY < fClipBottom; ++span){
+            if(span->fCoverage < 0){
+                blit(span->fY, span->fLeft, span->fRight, blitter);
+            }else{
+                blitCoverage(span->fY, span->fLeft, span->fRight,
+                             mask.fCoverage.data() + span->fCoverage, blended, blitter);
+            }
+        }
+    }
+
+    // The path's bounds in device space. Curves stay inside their control points, so the mapped
+    // corners of the points' bounds bound the fill.
+    GRect deviceBounds(const GPath& path) const {
+        GRect bounds = path.bounds();
+        GPoint corners[4] = {{bounds.fLeft, bounds.fTop}, {bounds.fRight, bounds.fTop},
+                             {bounds.fRight, bounds.fBottom}, {bounds.fLeft, bounds.fBottom}};
+        ctm.mapPoints(corners, 4);
+        return BoundsOf(corners, 4);
+    }
 
-        std::vector<Edges> edges;
-        GPath::Edger edger(copyPath);
-        GPoint points[4];
+    // True when a fill inside bounds (device space) can't reach a pixel of the clip rows: Clip
+    // would pin all of its edges onto one side of the device, or the walkers would find no rows.
+    // NaN bounds are left for the fill to deal with.
+    bool quickReject(const GRect& bounds) const {
+        return bounds.fRight <= 0 || bounds.fLeft >= this->fDevice.width()
+            || bounds.fBottom <= fClipTop || bounds.fTop >= fClipBottom;
+    }
+
+    static GRect BoundsOf(const GPoint pts[], int count){
+        GRect bounds = GRect::MakeLTRB(pts[0].fX, pts[0].fY, pts[0].fX, pts[0].fY);
+        for(int i = 1; i < count; i++){
+            bounds.fLeft = std::min(bounds.fLeft, pts[i].fX);
+            bounds.fTop = std::min(bounds.fTop, pts[i].fY);
+            bounds.fRight = std::max(bounds.fRight, pts[i].fX);
+            bounds.fBottom = std::max(bounds.fBottom, pts[i].fY);
+        }
+        return bounds;
+    }
+
+    // What FlattenPath may do with a curve whose control points are all off the device. Curves
+    // stay inside their control points; a pixel of slack covers the rounding in evaluating them.
+    enum CurveCull {
+        // Drop it when it is above or below the device: neither Clip nor the coverage
+        // accumulator keeps any part of a line there
+        kOffRows_CurveCull,
+        // Also replace it by the line between its flattened ends when it is left or right of
+        // the device. Clip pins all of those lines onto the device's side, where only the rows
+        // they span and their direction count, and those add up to the same as the one line.
+        kOffColumns_CurveCull,
+    };
+
+    // Map the path by matrix and hand each line of it, curves flattened, to line(p0, p1).
+    // Curves entirely off the width x height device are culled as cull allows.
+    template <typename LineProc>
+    static void FlattenPath(const GPath& path, const GMatrix& matrix, int width, int height,
+                            CurveCull cull, LineProc line) {
+        GPath::Edger edger(path);
+        GPoint points[GPath::kMaxEdgerPoints];
         GPath::Verb nextEdge = edger.next(points);
-        while(nextEdge != GPath::kDone){
+        for(; nextEdge != GPath::kDone; nextEdge = edger.next(points)){
+            const int count = nextEdge == GPath::kLine ? 2 : (nextEdge == GPath::kQuad ? 3 : 4);
+            // Map the segment by matrix
+            matrix.mapPoints(points, count);
             if(nextEdge == GPath::kLine){
-                Clip(points[0], points[1], edges);
-            }else if(nextEdge == GPath::kCubic){
+                line(points[0], points[1]);
+                continue;
+            }
+            const GRect hull = BoundsOf(points, count);
+            if(hull.fBottom < -1 || hull.fTop > height + 1){
+                continue;
+            }
+            const bool chord = cull == kOffColumns_CurveCull
+                               && (hull.fRight < -1 || hull.fLeft > width + 1);
+            if(nextEdge == GPath::kCubic){
                 float leftX = points[0].fX - 2 * points[1].fX + points[2].fX;
                 float rightX = points[1].fX - 2 * points[2].fX + points[3].fX;
                 float topY = points[0].fY - 2 * points[1].fY + points[2].fY;
@@ -450,33 +811,33 @@ public:
                 int lineSegmentCount = GCeilToInt(sqrtf(a / 0.25));
                 float deltaM = (float) 1 / lineSegmentCount;
 
-                float AX = 3 * points[1].fX + points[3].fX - points[0].fX - 3 * points[2].fX;
-                float BX = 3 * (points[0].fX - 2 * points[1].fX + points[2].fX);
-                float CX = 3 * (points[1].fX - points[0].fX);
-                float DX = points[0].fX;
-
-                float AY = 3 * points[1].fY + points[3].fY - points[0].fY - 3 * points[2].fY;
-                float BY = 3 * (points[0].fY - 2 * points[1].fY + points[2].fY);
-                float CY = 3 * (points[1].fY - points[0].fY);
-                float DY = points[0].fY;
-
-                float tile = 0.0;
-                for(int i = 0; i < lineSegmentCount; i++){
-                    float tile0 = tile;
-                    float tile1 = tile + deltaM;
-                    GPoint point0 = {((AX * tile0 + BX) * tile0 + CX) * tile0 + DX, ((AY * tile0 + BY) * tile0 + CY) * tile0 + DY};
-                    GPoint point1 = {((AX * tile1 + BX) * tile1 + CX) * tile1 + DX, ((AY * tile1 + BY) * tile1 + CY) * tile1 + DY};
-                    Clip(point0, point1, edges);
-                    tile += deltaM;
-                }
-            } else if(nextEdge == GPath::kQuad){
-                float AX = points[0].fX - 2 * points[1].fX + points[2].fX;
-                float BX = 2 * (points[1].fX - points[0].fX);
-                float CX = points[0].fX;
-
-                float AY = points[0].fY - 2 * points[1].fY + points[2].fY;
-                float BY = 2 * (points[1].fY - points[0].fY);
-                float CY = points[0].fY;
+                const float X[4] = {
+                    3 * points[1].fX + points[3].fX - points[0].fX - 3 * points[2].fX,
+                    3 * (points[0].fX - 2 * points[1].fX + points[2].fX),
+                    3 * (points[1].fX - points[0].fX),
+                    points[0].fX,
+                };
+                const float Y[4] = {
+                    3 * points[1].fY + points[3].fY - points[0].fY - 3 * points[2].fY,
+                    3 * (points[0].fY - 2 * points[1].fY + points[2].fY),
+                    3 * (points[1].fY - points[0].fY),
+                    points[0].fY,
+                };
+                FlattenCurve(X, Y, lineSegmentCount, deltaM, chord, line);
+            } else {
+                // A quad is a cubic with no t^3 term
+                const float X[4] = {
+                    0,
+                    points[0].fX - 2 * points[1].fX + points[2].fX,
+                    2 * (points[1].fX - points[0].fX),
+                    points[0].fX,
+                };
+                const float Y[4] = {
+                    0,
+                    points[0].fY - 2 * points[1].fY + points[2].fY,
+                    2 * (points[1].fY - points[0].fY),
+                    points[0].fY,
+                };
 
                 float leftX = (points[0].fX - 2 * points[1].fX + points[2].fX) / 4;
                 float leftY = (points[0].fY - 2 * points[1].fY + points[2].fY) / 4;
@@ -484,111 +845,504 @@ public:
 
                 int lineSegmentCount = GCeilToInt(sqrt(a / 0.25));
                 float deltaM = (float) 1 / lineSegmentCount;
-                float tile = 0.0;
-                for(int j = 0; j < lineSegmentCount; j++){
-                    float tile0 = tile;
-                    float tile1 = tile + deltaM;
-                    GPoint point0 = {(AX * tile0 + BX) * tile0 + CX, (AY * tile0 + BY) * tile0 + CY};
-                    GPoint point1 = {(AX * tile1 + BX) * tile1 + CX, (AY * tile1 + BY) * tile1 + CY};
-                    Clip(point0, point1, edges);
-                    tile += deltaM;
-                }
+                FlattenCurve(X, Y, lineSegmentCount, deltaM, chord, line);
             }
-            nextEdge = edger.next(points);
         }
-        
-        if(edges.empty() == false){
-            // Sort the edges according Y from top to bottom, then according X from left to right, then according to slope
-            std::sort(edges.begin(), edges.end());
-            // Walk through the array
-            int minY = FindMinY(edges);
-            int maxY = FindMaxY(edges);
-            int edgeAmount = edges.size();
-            for(int y = minY; y < maxY; ){
-                int leftX;
-                int rightX;
-                int edgeIndex = 0;
-                int a = 0;
-                Edges edge = edges.front();
-
-                while(edge.topY <= y){ // For each edge active for this y
-                    if(a == 0) {
-                        leftX = GRoundToInt(edge.currentX);
-                    }
-                    a += edge.fW;
-                    if(a == 0){
-                        rightX = GRoundToInt(edge.currentX);
-                        // boundary check
-                        if(leftX < 0 ){
-                            leftX = 0;
-                        } else if(leftX > this->fDevice.width() - 1){
-                            leftX = this->fDevice.width()-1; }
-                        if(rightX < 0 ){
-                            leftX = 0;
-                        } else if( rightX > this->fDevice.width() - 1){
-                            rightX = this->fDevice.width() - 1;
-                        }
+    }
+
+    // The curve x(t) = ((X[0] * t + X[1]) * t + X[2]) * t + X[3], y(t) likewise. With X[0] == 0
+    // (a quad) this is exactly the quad's own (X[1] * t + X[2]) * t + X[3].
+    static GPoint EvalCurve(const float X[4], const float Y[4], float t){
+        return {((X[0] * t + X[1]) * t + X[2]) * t + X[3], ((Y[0] * t + Y[1]) * t + Y[2]) * t + Y[3]};
+    }
 
-                        if(paint.getShader() == nullptr){ // Shader
-                            blit(y, leftX, rightX, paint);
-                        }else{
-                            if (!paint.getShader()->setContext(ctm)) {
-                                return;
-                            }
-                            blit_shadeRow(y, leftX, rightX, paint);
+    // Hand the lines between the curve's points at t = 0, deltaM, 2 * deltaM, ... to
+    // line(p0, p1), lineSegmentCount of them, or for a chord just the one line from the first
+    // point to the last. t is summed a step at a time. Each point is evaluated once, four at a
+    // time with SSE2, by the same operations as EvalCurve, so every lane lands where the scalar
+    // code would.
+    template <typename LineProc>
+    static void FlattenCurve(const float X[4], const float Y[4], int lineSegmentCount, float deltaM,
+                             bool chord, LineProc line) {
+        float tile = 0.0;
+        if(chord){
+            for(int i = 0; i < lineSegmentCount; i++){
+                tile += deltaM;
+            }
+            line(EvalCurve(X, Y, 0.0f), EvalCurve(X, Y, tile));
+            return;
+        }
+        GPoint previous = EvalCurve(X, Y, 0.0f);
+        int i = 0;
+#if defined(__SSE2__)
+        const __m128 ax = _mm_set1_ps(X[0]), bx = _mm_set1_ps(X[1]);
+        const __m128 cx = _mm_set1_ps(X[2]), dx = _mm_set1_ps(X[3]);
+        const __m128 ay = _mm_set1_ps(Y[0]), by = _mm_set1_ps(Y[1]);
+        const __m128 cy = _mm_set1_ps(Y[2]), dy = _mm_set1_ps(Y[3]);
+        for(; i + 4 <= lineSegmentCount; i += 4){
+            float ts[4];
+            for(int k = 0; k < 4; k++){
+                tile += deltaM;
+                ts[k] = tile;
+            }
+            const __m128 t = _mm_loadu_ps(ts);
+            float xs[4], ys[4];
+            _mm_storeu_ps(xs, _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(
+                    _mm_add_ps(_mm_mul_ps(ax, t), bx), t), cx), t), dx));
+            _mm_storeu_ps(ys, _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(
+                    _mm_add_ps(_mm_mul_ps(ay, t), by), t), cy), t), dy));
+            for(int k = 0; k < 4; k++){
+                const GPoint next = {xs[k], ys[k]};
+                line(previous, next);
+                previous = next;
+            }
+        }
+#endif
+        for(; i < lineSegmentCount; i++){
+            tile += deltaM;
+            const GPoint next = EvalCurve(X, Y, tile);
+            line(previous, next);
+            previous = next;
+        }
+    }
+
+    // Anti-aliased fill of the contours made of segments (pairs of device-space points, each a
+    // line), all of them inside bounds. Fully covered runs blit as usual; partly covered pixels
+    // are blended and then mixed into the device by their coverage.
+    void fillAntiAliased(const GRect& bounds, const GArenaArray<GPoint>& segments,
+                         const GPaint& paint) {
+        // The pixels the fill can touch, within the device and the clip rows
+        float left = std::max(bounds.fLeft, 0.0f);
+        float top = std::max(bounds.fTop, (float) fClipTop);
+        float right = std::min(bounds.fRight, (float) this->fDevice.width());
+        float bottom = std::min(bounds.fBottom, (float) fClipBottom);
+        if(!(left < right && top < bottom)){
+            return;
+        }
+        const int leftX = GFloorToInt(left);
+
+        GArenaScope scope(&fArena);
+        Blitter blitter;
+        if(!makeBlitter(paint, &blitter)){
+            return;
+        }
+        GPixel* blended = fArena.makeArray<GPixel>(kShadeChunk, kBufferAlign);
+        resolveCoverage(segments, leftX, GFloorToInt(top), GCeilToInt(right) - leftX,
+                        GCeilToInt(bottom), [&](int y, int x, int end, const uint8_t coverage[]){
+            ForEachCoverageRun(coverage, x, end, [&](int l, int r){
+                blit(y, leftX + l, leftX + r, blitter);
+            }, [&](int l, int r){
+                blitCoverage(y, leftX + l, leftX + r, coverage + l, blended, blitter);
+            });
+        });
+    }
+
+    // Accumulate the segments' coverage of columns [leftX, leftX + width) and rows [topY, bottomY),
+    // and hand each row to row(y, x, end, coverage): coverage[x...end) (relative to leftX) is all
+    // the row covers.
+    template <typename RowProc>
+    void resolveCoverage(const GArenaArray<GPoint>& segments, int leftX, int topY, int width,
+                         int bottomY, RowProc row) {
+        GArenaScope scope(&fArena);
+        const size_t storageSize = CoverageAccumulator::StorageSize(this->fDevice.width());
+        if(fCoverage.size() < storageSize){
+            fCoverage.resize(storageSize);
+        }
+        CoverageAccumulator acc(fCoverage.data(), leftX, width);
+        uint8_t* coverage = fArena.makeArray<uint8_t>(width);
+        for(int bandTop = topY; bandTop < bottomY; bandTop += CoverageAccumulator::kMaxRows){
+            const int bandBottom = std::min(bottomY, bandTop + (int) CoverageAccumulator::kMaxRows);
+            acc.setRows(bandTop, bandBottom - bandTop);
+            for(int i = 0; i < segments.size(); i += 2){
+                acc.addLine(segments[i], segments[i + 1]);
+            }
+            for(int y = bandTop; y < bandBottom; y++){
+                int x, end;
+                acc.resolveRow(y, coverage, &x, &end);
+                row(y, x, end, coverage);
+            }
+        }
+    }
+
+    // Split coverage[x...end) into fully covered runs, full(l, r), and runs to mix by coverage,
+    // partial(l, r). Empty runs are skipped.
+    template <typename FullProc, typename PartialProc>
+    static void ForEachCoverageRun(const uint8_t coverage[], int x, int end, FullProc full,
+                                   PartialProc partial) {
+        while(x < end){
+            const int start = x;
+            if(coverage[x] == 0){
+                x = SkipRun(coverage, x, end, 0);
+            }else if(coverage[x] == 0xFF){
+                x = SkipRun(coverage, x, end, 0xFF);
+                full(start, x);
+            }else{
+                // Take in short runs of 0 or 0xFF too, mixing them (exactly) with the rest,
+                // so thin shapes don't pay for a blit per run
+                while(x < end){
+                    if(coverage[x] == 0 || coverage[x] == 0xFF){
+                        int runEnd = SkipRun(coverage, x, end, coverage[x]);
+                        if(runEnd - x >= kMinCoverageRun){
+                            break;
                         }
+                        x = runEnd;
+                    }else{
+                        x++;
                     }
-                    Edges next = Edges(0, 0, 0.0, 0.0, 0);
-                    if(edgeIndex + 1 < edges.size()){
-                        next = edges[edgeIndex + 1];
-                    }
+                }
+                partial(start, x);
+            }
+        }
+    }
 
-                    // All done with edge
-                    if(edge.bottomY == y + 1){
-                        std::vector<Edges>::iterator iteration = edges.begin();
-                        // Remove the edge from edges
-                        edges.erase(iteration + edgeIndex);
-                        edgeIndex--;
-                    }else{
-                        edges[edgeIndex].currentX += edge.slope;
-                        resortBackwards(edgeIndex, edges);
+    // The end of the run of value that starts at coverage[x], checking 8 bytes at a time
+    static int SkipRun(const uint8_t coverage[], int x, int width, uint8_t value){
+        const uint64_t pattern = value * 0x0101010101010101ull;
+        for(; x + 8 <= width; x += 8){
+            uint64_t bytes;
+            memcpy(&bytes, coverage + x, 8);
+            if(bytes != pattern){
+                break;
+            }
+        }
+        while(x < width && coverage[x] == value){
+            x++;
+        }
+        return x;
+    }
+
+    // Blit [leftX, rightX) of row y into blended[], a chunk at a time, and mix each chunk into
+    // the device by coverage[]
+    void blitCoverage(int y, int leftX, int rightX, const uint8_t coverage[], GPixel blended[],
+                      const Blitter& blitter) {
+        GPixel* dst = this->fDevice.getAddr(leftX, y);
+        const int count = rightX - leftX;
+        for(int x = 0; x < count; x += kShadeChunk){
+            const int n = std::min(count - x, (int)kShadeChunk);
+            memcpy(blended, dst + x, n * sizeof(GPixel));
+            blitRow(blended, leftX + x, y, n, blitter);
+            lerpRow(dst + x, blended, coverage + x, n);
+        }
+    }
+
+
+    // Scan-convert the edges with the non-zero winding rule. Edges are bucketed by topY into a
+    // global edge table; the active edge list only holds edges that cross the current scanline
+    // and is kept sorted by currentX as edges enter, step and retire.
+    void fillEdges(PathEdges& edges, bool convex, const GPaint& paint) {
+        GArenaScope scope(&fArena);
+        Blitter blitter;
+        // If the shader fails, or the paint can't change anything, return with nothing
+        if(!makeBlitter(paint, &blitter)){
+            return;
+        }
+        scanEdges(edges, convex, fClipTop, fClipBottom, [&](int y, int leftX, int rightX){
+            blit(y, leftX, rightX, blitter);
+        });
+    }
+
+    // walkConvexEdges for a convex path's edges when it can take them, else walkEdges
+    template <typename SpanProc>
+    void scanEdges(PathEdges& edges, bool convex, int clipTop, int clipBottom, SpanProc span) {
+        if(!(convex && walkConvexEdges(edges, clipTop, clipBottom, span))){
+            walkEdges(edges, clipTop, clipBottom, span);
+        }
+    }
+
+    // fillEdges' scan conversion of rows [clipTop, clipBottom), handing each span to
+    // span(y, leftX, rightX). A chain's edge takes on the chain's next line when its line ends,
+    // so each chain is stepped through once.
+    template <typename SpanProc>
+    void walkEdges(PathEdges& pathEdges, int clipTop, int clipBottom, SpanProc span) {
+        const Edges* edges = pathEdges.fEdges.data();
+        const int edgeCount = pathEdges.fEdges.size();
+        EdgeChain* chains = pathEdges.fChains.data();
+        const GPoint* chainPoints = pathEdges.fPoints.data();
+        int minY = FindMinY(edges, edgeCount);
+        int maxY = FindMaxY(edges, edgeCount);
+        for(const EdgeChain& chain : pathEdges.fChains){
+            maxY = std::max(maxY, chain.fBottomY);
+        }
+
+        // Counting sort of the edges into one bucket per scanline. The table holds indices, so
+        // no edge is copied until it goes active.
+        const int bucketCount = maxY - minY + 2;
+        int* bucketStart = fArena.makeArray<int>(bucketCount);
+        std::fill(bucketStart, bucketStart + bucketCount, 0);
+        for(int i = 0; i < edgeCount; i++){
+            bucketStart[edges[i].topY - minY + 1]++;
+        }
+        for(int i = 1; i < bucketCount; i++){
+            bucketStart[i] += bucketStart[i - 1];
+        }
+        int* table = fArena.makeArray<int>(edgeCount);
+        int* fill = fArena.makeArray<int>(bucketCount - 1);
+        std::copy(bucketStart, bucketStart + bucketCount - 1, fill);
+        for(int i = 0; i < edgeCount; i++){
+            table[fill[edges[i].topY - minY]++] = i;
+        }
+
+        // Rows above the clip are not drawn, but edges that start there are stepped down to the
+        // first drawn row.
+        int startY = std::max(minY, clipTop);
+        int stopY = std::min(maxY, clipBottom);
+        if(startY >= stopY){
+            return;
+        }
+        GArenaArray<Edges> above(&fArena);
+        for(int i = 0; i < bucketStart[std::max(startY - minY, 0)]; i++){
+            Edges edge = edges[table[i]];
+            while(edge.bottomY <= startY && edge.fChain >= 0
+                  && NextChainEdge(chains[edge.fChain], chainPoints, &edge)){
+            }
+            if(edge.bottomY > startY){
+                // Fixed point steps exactly, so the rows above add up in one go
+                edge.currentX += edge.slope * (startY - edge.topY);
+                above.push_back(edge);
+            }
+        }
+        std::sort(above.begin(), above.end(), [](const Edges& a, const Edges& b) {
+            return a.currentX < b.currentX;
+        });
+        ActiveEdges active(&fArena, edgeCount);
+        Edges* incoming = fArena.makeArray<Edges>(edgeCount);
+        active.mergeSorted(above.data(), above.size());
+        for(int y = startY; y < stopY; y++){
+            // Merge in the edges starting on this scanline, keeping the list sorted by x
+            const int first = bucketStart[y - minY];
+            const int incomingCount = bucketStart[y - minY + 1] - first;
+            if(incomingCount > 0){
+                for(int i = 0; i < incomingCount; i++){
+                    incoming[i] = edges[table[first + i]];
+                }
+                SortIncoming(incoming, incomingCount);
+                active.mergeSorted(incoming, incomingCount);
+            }
+            if(active.fCount == 0){
+                // Jump to the next scanline that has edges starting on it
+                int next = y - minY + 1;
+                while(next < stopY - minY && bucketStart[next] == bucketStart[next + 1]){
+                    next++;
+                }
+                y = next + minY - 1;
+                continue;
+            }
+
+            int leftX = 0;
+            int rightX;
+            int a = 0;
+            for(int i = 0; i < active.fCount; i++){
+                if(a == 0) {
+                    leftX = EdgeRound(active.fX[i]);
+                }
+                a += active.fW[i];
+                if(a == 0){
+                    rightX = EdgeRound(active.fX[i]);
+                    clampSpan(leftX, rightX);
+                    span(y, leftX, rightX);
+                }
+            }
+
+            // Step every edge to the next scanline, then retire the finished ones. A chain's
+            // next line starts on the row its last one stopped before.
+            active.step();
+            int kept = 0;
+            for(int i = 0; i < active.fCount; i++){
+                if(active.fBottomY[i] > y + 1){
+                    if(kept != i){
+                        active.move(kept, i);
                     }
-                    if(edgeIndex + 1 >= edges.size()){
-                        break;
-                    }else{
-                        edge = next;
-                        edgeIndex++; // edgeIndex => next
+                    kept++;
+                }else if(active.fChain[i] >= 0){
+                    Edges edge(0, 0, 0, 0, 0, active.fChain[i]);
+                    if(NextChainEdge(chains[edge.fChain], chainPoints, &edge)){
+                        active.set(kept++, edge);
                     }
                 }
-                y  = y + 1;
-                while(edge.topY == y){
-                    Edges next = Edges(0, 0, 0, 0, 0);
-                    if(edgeIndex + 1 < edges.size()){
-                        next = edges[edgeIndex + 1];
-                    }
-                    resortBackwards(edgeIndex, edges);
-                    if(edgeIndex + 1 >= edges.size()){
-                        break;
+            }
+            active.fCount = kept;
+            // Stepping only swaps edges that cross, so one insertion pass restores the order
+            for(int i = 1; i < kept; i++){
+                active.insertSorted(i);
+            }
+        }
+    }
 
-                    }else{
-                        edge = next;
-                        edgeIndex++;
-                    }
+    // Stable sort of a scanline's new edges by currentX. There are usually only a few, which
+    // insertion sorts in place, where stable_sort would allocate.
+    static void SortIncoming(Edges incoming[], int count){
+        if(count > 16){
+            std::stable_sort(incoming, incoming + count, [](const Edges& a, const Edges& b) {
+                return a.currentX < b.currentX;
+            });
+            return;
+        }
+        for(int i = 1; i < count; i++){
+            Edges edge = incoming[i];
+            int j = i;
+            while(j > 0 && edge.currentX < incoming[j - 1].currentX){
+                incoming[j] = incoming[j - 1];
+                j--;
+            }
+            incoming[j] = edge;
+        }
+    }
+
+    // The scanners' boundary check of a span's ends
+    void clampSpan(int& leftX, int& rightX) const {
+        if(leftX < 0 ){
+            leftX = 0;
+        } else if(leftX > this->fDevice.width() - 1){
+            leftX = this->fDevice.width()-1; }
+        if(rightX < 0 ){
+            leftX = 0;
+        } else if( rightX > this->fDevice.width() - 1){
+            rightX = this->fDevice.width() - 1;
+        }
+    }
+
+    // The row below the last one the edge covers: a chain's edge goes on to the chain's bottom
+    static int EdgeBottom(const Edges& edge, const EdgeChain chains[]){
+        return edge.fChain >= 0 ? chains[edge.fChain].fBottomY : edge.bottomY;
+    }
+
+    // Add edge to side[0..count), keeping it sorted by topY
+    static void InsertByTop(Edges side[], int count, const Edges& edge){
+        int i = count;
+        while(i > 0 && edge.topY < side[i - 1].topY){
+            side[i] = side[i - 1];
+            i--;
+        }
+        side[i] = edge;
+    }
+
+    // walkEdges for a convex path: one side of it goes down and the other up, so every row has
+    // one edge of each and the span runs between them. There's no edge table, no sort by x and
+    // no winding, just an edge per side stepping down its list. The lists come from the path's
+    // order, the up side read backwards, so they are nearly in topY order already.
+    //
+    // Returns false, having made no spans, when the edges don't split into two sides whose edges
+    // follow one another down the rows (flattening or clipping can bend a convex path), and
+    // walkEdges should scan them instead.
+    template <typename SpanProc>
+    bool walkConvexEdges(PathEdges& pathEdges, int clipTop, int clipBottom, SpanProc span) {
+        const Edges* edges = pathEdges.fEdges.data();
+        const int edgeCount = pathEdges.fEdges.size();
+        EdgeChain* chains = pathEdges.fChains.data();
+        const GPoint* chainPoints = pathEdges.fPoints.data();
+        // The down side starts where the winding turns to -1, and the up side ends there
+        int start = -1;
+        int turns = 0;
+        for(int i = 0; i < edgeCount; i++){
+            if(edges[i].fW != edges[(i + edgeCount - 1) % edgeCount].fW){
+                turns++;
+                if(edges[i].fW < 0){
+                    start = i;
+                }
+            }
+        }
+        if(turns != 2){
+            return false;
+        }
+        Edges* sides[2] = {fArena.makeArray<Edges>(edgeCount), fArena.makeArray<Edges>(edgeCount)};
+        int sideCount[2] = {0, 0};
+        for(int i = 0; i < edgeCount; i++){
+            const Edges& down = edges[(start + i) % edgeCount];
+            if(down.fW < 0){
+                InsertByTop(sides[0], sideCount[0]++, down);
+            }
+            const Edges& up = edges[(start + edgeCount - 1 - i) % edgeCount];
+            if(up.fW > 0){
+                InsertByTop(sides[1], sideCount[1]++, up);
+            }
+        }
+        // Only one edge of a side may cross any row
+        for(int s = 0; s < 2; s++){
+            for(int i = 1; i < sideCount[s]; i++){
+                if(sides[s][i].topY < EdgeBottom(sides[s][i - 1], chains)){
+                    return false;
+                }
+            }
+        }
+
+        // Rows above the clip are stepped through without drawing
+        const int minY = std::min(sides[0][0].topY, sides[1][0].topY);
+        const int stopY = std::min(std::min(EdgeBottom(sides[0][sideCount[0] - 1], chains),
+                                            EdgeBottom(sides[1][sideCount[1] - 1], chains)),
+                                   clipBottom);
+        Edges edge[2] = {sides[0][0], sides[1][0]};
+        int next[2] = {1, 1};
+        for(int y = minY; y < stopY; y++){
+            if(y >= clipTop && edge[0].topY <= y && edge[1].topY <= y){
+                int leftX = EdgeRound(std::min(edge[0].currentX, edge[1].currentX));
+                int rightX = EdgeRound(std::max(edge[0].currentX, edge[1].currentX));
+                clampSpan(leftX, rightX);
+                span(y, leftX, rightX);
+            }
+            // Step each side's edge to the next row, or move on to the side's next edge
+            for(int s = 0; s < 2; s++){
+                Edges& current = edge[s];
+                if(current.topY > y){
+                    continue;
+                }
+                if(current.bottomY > y + 1){
+                    current.currentX += current.slope;
+                }else if(current.fChain >= 0
+                         && NextChainEdge(chains[current.fChain], chainPoints, &current)){
+                    // The chain's next line starts on the next row
+                }else if(next[s] < sideCount[s]){
+                    current = sides[s][next[s]++];
+                }else{
+                    current.topY = stopY;
                 }
             }
         }
+        return true;
     }
 
 
     void drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) override {
+        // Fewer than 3 points have no area
+        if(count < 3){
+            return;
+        }
+        GArenaScope scope(&fArena);
         // map points by ctm
-        GPoint mapPoints[count];
-        for(int i = 0; i < count; i++){
-            GPoint myPoint = ctm.mapPt(points[i]);
-            mapPoints[i] = myPoint;
+        GPoint* mapPoints = fArena.makeArray<GPoint>(count);
+        ctm.mapPoints(mapPoints, points, count);
+        const GRect bounds = BoundsOf(mapPoints, count);
+        if(quickReject(bounds)){
+            return;
+        }
+        if(paint.isAntiAlias()){
+            GArenaArray<GPoint> segments(&fArena, 2 * count);
+            for(int i = 0; i < count; i++){
+                segments.push_back(mapPoints[i]);
+                segments.push_back(mapPoints[(i + 1) % count]);
+            }
+            fillAntiAliased(bounds, segments, paint);
+            return;
+        }
+        if(count == 4 && IsAxisAlignedQuad(mapPoints)
+           && std::isfinite(bounds.fLeft + bounds.fTop + bounds.fRight + bounds.fBottom)){
+            fillAxisAlignedRect(bounds, paint);
+            return;
+        }
+        // Inside the device Clip would make one edge of each line, which the chains make too
+        if(bounds.fLeft >= 0 && bounds.fTop >= 0 && bounds.fRight <= this->fDevice.width()
+           && bounds.fBottom <= this->fDevice.height()){
+            bool filled;
+            switch(count){
+                case 3:  filled = fillConvexChains<3>(mapPoints, count, paint); break;
+                case 4:  filled = fillConvexChains<4>(mapPoints, count, paint); break;
+                default: filled = fillConvexChains<0>(mapPoints, count, paint); break;
+            }
+            if(filled){
+                return;
+            }
         }
         // make edge list
-        std::vector<Edges> edge;
+        GArenaArray<Edges> edge(&fArena, 3 * count);
         for(int a = 0; a < count; a++){
             int b;
             if(a == count -1 ){
@@ -598,44 +1352,29 @@ public:
             }
             Clip(mapPoints[a], mapPoints[b], edge);
         }
-        if(edge.empty() == false){
+        Blitter blitter;
+        // If the shader fails, or the paint can't change anything, return nothing
+        if(edge.empty() == false && makeBlitter(paint, &blitter)){
             // Sort the edges according Y from top to bottom, then according X from left to right, then according to slope
             std::sort(edge.begin(),edge.end());
             // Walk through the array
-            int minY = FindMinY(edge);
-            int maxY = FindMaxY(edge);
+            int minY = FindMinY(edge.data(), edge.size());
+            int maxY = FindMaxY(edge.data(), edge.size());
             Edges leftEdge = edge[0];
             Edges rightEdge = edge[1];
             int edgeAmount = edge.size();
             int currentEdgeIndex = 2;
 
-            for(int y = minY; y < maxY; y++){
-                // Find leftX for leftEdge
-                float leftX = leftEdge.currentX;
-                float rightX = rightEdge.currentX;
+            for(int y = minY; y < std::min(maxY, fClipBottom); y++){
                 // Round leftX and rightX
-                int roundedLeftX = GRoundToInt(leftX);
-                int roundedRightX = GRoundToInt(rightX);
-                // Boundary check
-                if(roundedLeftX < 0 ){
-                    roundedLeftX = 0;
-                } else if(roundedLeftX > this->fDevice.width()-1){
-                    roundedLeftX = this->fDevice.width()-1;
-                }
-                if(roundedRightX < 0 ){
-                    roundedLeftX = 0;
-                } else if(roundedRightX > this->fDevice.width()-1){
-                    roundedRightX = this->fDevice.width()-1;
-                }
-                
-                if(paint.getShader() == nullptr){ // Use shader
-                    blit(y, roundedLeftX, roundedRightX, paint);
+                int roundedLeftX = EdgeRound(leftEdge.currentX);
+                int roundedRightX = EdgeRound(rightEdge.currentX);
+                clampSpan(roundedLeftX, roundedRightX);
+
+                if(y < fClipTop){
+                    // Above the clip: nothing to draw, the edges just step
                 }else{
-                    // If the shader fails, return nothing
-                    if (!paint.getShader()->setContext(ctm)) {
-                        return;
-                    }
-                    blit_shadeRow(y, roundedLeftX, roundedRightX, paint);
+                    blit(y, roundedLeftX, roundedRightX, blitter);
                 }
                 // Increment x
                 leftEdge.currentX += leftEdge.slope;
@@ -652,6 +1391,93 @@ public:
             }
         }
     }
+
+    // The quad's sides are all horizontal or vertical
+    static bool IsAxisAlignedQuad(const GPoint p[4]){
+        return (p[0].fY == p[1].fY && p[1].fX == p[2].fX && p[2].fY == p[3].fY && p[3].fX == p[0].fX)
+            || (p[0].fX == p[1].fX && p[1].fY == p[2].fY && p[2].fX == p[3].fX && p[3].fY == p[0].fY);
+    }
+
+    // drawConvexPolygon's scan of a polygon inside the device, without making or sorting its edge
+    // list. From the top vertex one chain of edges goes down the points in order and the other
+    // goes down them in reverse; merging the two chains' next edges hands them out in exactly the
+    // order the sorted list would. Each side steps as the sorted scan's does, moving to the next
+    // edge the row after its edge ends. N is the point count, or 0 for any count.
+    //
+    // Returns false, having drawn nothing, when the points don't go down and back up once (they
+    // aren't convex) or both chains start on the same edge values, which the sort could order
+    // either way: the edge list's scan draws those.
+    template <int N>
+    bool fillConvexChains(const GPoint mapPoints[], int pointCount, const GPaint& paint) {
+        const int count = N > 0 ? N : pointCount;
+        int top = 0;
+        for(int i = 1; i < count; i++){
+            if(mapPoints[i].fY < mapPoints[top].fY){
+                top = i;
+            }
+        }
+        // The points from the top one, and back to it again at pts[count]
+        GPoint* pts = fArena.makeArray<GPoint>(count + 1);
+        for(int i = 0; i <= count; i++){
+            pts[i] = mapPoints[top + i < count ? top + i : top + i - count];
+        }
+        int bottom = 0;
+        while(bottom < count && pts[bottom + 1].fY >= pts[bottom].fY){
+            bottom++;
+        }
+        for(int i = bottom; i < count; i++){
+            if(pts[i + 1].fY > pts[i].fY){
+                return false;
+            }
+        }
+
+        EdgeChain chains[2] = {{0, bottom, 1, 0}, {count, bottom, -1, 0}};
+        Edges heads[2] = {Edges(0, 0, 0, 0, 0), Edges(0, 0, 0, 0, 0)};
+        bool hasHead[2];
+        for(int c = 0; c < 2; c++){
+            hasHead[c] = NextChainEdge(chains[c], pts, &heads[c]);
+        }
+        if(hasHead[0] != hasHead[1] || (hasHead[0] && !(heads[0] < heads[1])
+                                                   && !(heads[1] < heads[0]))){
+            return false;
+        }
+        Blitter blitter;
+        // If there are no rows, the shader fails, or the paint can't change anything, it's done
+        if(!hasHead[0] || !makeBlitter(paint, &blitter)){
+            return true;
+        }
+        // Set *edge to the next edge of the sorted list
+        auto takeEdge = [&](Edges* edge){
+            const int c = hasHead[0] && (!hasHead[1] || !(heads[1] < heads[0])) ? 0 : 1;
+            if(hasHead[c]){
+                *edge = heads[c];
+                hasHead[c] = NextChainEdge(chains[c], pts, &heads[c]);
+            }
+        };
+        Edges leftEdge = heads[0];
+        Edges rightEdge = heads[0];
+        takeEdge(&leftEdge);
+        takeEdge(&rightEdge);
+        const int minY = leftEdge.topY;
+        const int stopY = std::min(GRoundToInt(pts[bottom].fY), fClipBottom);
+        for(int y = minY; y < stopY; y++){
+            if(y >= fClipTop){
+                int leftX = EdgeRound(leftEdge.currentX);
+                int rightX = EdgeRound(rightEdge.currentX);
+                clampSpan(leftX, rightX);
+                blit(y, leftX, rightX, blitter);
+            }
+            leftEdge.currentX += leftEdge.slope;
+            rightEdge.currentX += rightEdge.slope;
+            if(leftEdge.bottomY <= y){
+                takeEdge(&leftEdge);
+            }
+            if(rightEdge.bottomY <= y){
+                takeEdge(&rightEdge);
+            }
+        }
+        return true;
+    }
     
     void clear(const GColor& color) {
 		GPaint paint(color);
@@ -668,70 +1494,150 @@ public:
                        p1.fY-p0.fY, p2.fY-p0.fY, p0.fY);
         return matrix;
     }
-/*
-    void drawTriangle(const GPoint pts[3], const GPaint& paint){
-        if(paint.getShader() != nullptr){
-            if (!paint.getShader()->setContext(ctm)) {
-                return;
-            } // If the shader fails, return with nothing
-            drawConvexPolygon(pts, 3, paint);
-        }else{
-            drawConvexPolygon(pts, 3, paint);
+    // Rasterize one triangle with half-space edge functions. A pixel is drawn when its center is
+    // inside all three edges; a center exactly on an edge belongs to only one of the triangles
+    // sharing that edge, so meshes get no seams and no double blends. Colors are interpolated
+    // with barycentric weights stepped across each span; texs map the shader onto the triangle
+    // through one affine context per triangle. p[] is pts[] mapped by ctm.
+    void fillTriangle(const GPoint pts[3], const GPoint p[3], const GColor colors[],
+                      const GPoint texs[], GShader* shader, BlendRowProc proc) {
+        // Edge i runs from p[i] to p[i + 1]: E(x, y) = A * x + B * y + C. Swapping the ends
+        // negates A, B and C exactly, so both triangles on an edge see bit-identical crossings.
+        float A[3], B[3], C[3];
+        for(int i = 0; i < 3; i++){
+            const GPoint& s = p[i];
+            const GPoint& e = p[(i + 1) % 3];
+            A[i] = s.fY - e.fY;
+            B[i] = e.fX - s.fX;
+            C[i] = s.fX * e.fY - e.fX * s.fY;
+        }
+        // Twice the signed area; flip the edges so the inside is positive
+        float area = A[0] * p[2].fX + B[0] * p[2].fY + C[0];
+        if(!(area != 0 && std::isfinite(area))){
+            return;
+        }
+        if(area < 0){
+            for(int i = 0; i < 3; i++){
+                A[i] = -A[i];
+                B[i] = -B[i];
+                C[i] = -C[i];
+            }
+            area = -area;
         }
-    }
-*/
-    /*
-    void drawTriangle(const GPoint vertices[3], const GPaint& paint) {
-        this->drawConvexPolygon(vertices, 3, paint);
-    }
-
-    */
-
-    void drawTriangleWithTex(const GPoint pts[],
-                              const GPoint tex[],
-                              const GPaint& paint) {
-        GMatrix P, T, invT;
-
-        P = computeBasis(pts[0], pts[1], pts[2]);
-        T = computeBasis(tex[0], tex[1], tex[2]);
-
-        T.invert(&invT);
-
-        GMatrix temp;
-        temp.setConcat(P, invT);
-
-        ProxyShader proxy(paint.getShader(), temp);
-
-        this->drawConvexPolygon(pts, 3, GPaint(&proxy));
-    }
-
-    void drawTriangleWithColor(const GPoint pts[],
-                             const GColor colors[],
-                             const GPaint& paint) {
-
-        TriColorShader colorShader(pts, colors);
-        // this->drawTriangle(pts, GPaint(&colorShader));
-        this->drawConvexPolygon(pts, 3, GPaint(&colorShader));
-    }
-
-    void drawTriangleWithBoth(const GPoint pts[], const GColor colors[], const GPoint texs[], const GPaint& paint) {
-
-        GMatrix P, T, invT;
-        P = computeBasis(pts[0], pts[1], pts[2]);
-        T = computeBasis(texs[0], texs[1], texs[2]);
-
-        T.invert(&invT);
-        GMatrix temp;
-        temp.setConcat(P, invT);
-
-        TriColorShader color(pts,colors);
-        ProxyShader proxy(paint.getShader(), temp);
 
-        ComposeShader compShader(&color, &proxy);
+        float minY = std::min(std::min(p[0].fY, p[1].fY), p[2].fY);
+        float maxY = std::max(std::max(p[0].fY, p[1].fY), p[2].fY);
+        int top = GFloorToInt(std::max(minY, (float) fClipTop));
+        int bottom = GCeilToInt(std::min(maxY, (float) fClipBottom));
+        if(top >= bottom){
+            return;
+        }
+        // Every row of a triangle left or right of the device is empty
+        if(std::max(std::max(p[0].fX, p[1].fX), p[2].fX) <= 0
+           || std::min(std::min(p[0].fX, p[1].fX), p[2].fX) >= this->fDevice.width()){
+            return;
+        }
 
-        //this->drawTriangle(pts, GPaint(&compShader));
-        this->drawConvexPolygon(pts, 3, GPaint(&compShader));
+        GArenaScope scope(&fArena);
+        const GShader::Context* context = nullptr;
+        if(texs != nullptr){
+            GMatrix P = computeBasis(pts[0], pts[1], pts[2]);
+            GMatrix T = computeBasis(texs[0], texs[1], texs[2]);
+            GMatrix invT;
+            if(!T.invert(&invT)){
+                return;
+            }
+            GMatrix M;
+            M.setConcat(P, invT);
+            M.setConcat(ctm, M);
+            context = shader->makeContext(M, &fArena);
+            if(context == nullptr){
+                return;
+            }
+        }
+        // Color at a pixel = c0 + w1 * (c1 - c0) + w2 * (c2 - c0), where the weights of p1 and p2
+        // are E2 / area and E0 / area; d*/dx are the per-pixel steps.
+        float c0[4], d1[4], d2[4], ddx[4];
+        if(colors != nullptr){
+            float v[3][4];
+            for(int i = 0; i < 3; i++){
+                v[i][0] = colors[i].fA;
+                v[i][1] = colors[i].fR;
+                v[i][2] = colors[i].fG;
+                v[i][3] = colors[i].fB;
+            }
+            for(int k = 0; k < 4; k++){
+                c0[k] = v[0][k];
+                d1[k] = (v[1][k] - v[0][k]) / area;
+                d2[k] = (v[2][k] - v[0][k]) / area;
+                ddx[k] = d1[k] * A[2] + d2[k] * A[0];
+            }
+        }
 
+        const int w = this->fDevice.width();
+        GPixel* storage = fArena.makeArray<GPixel>(kShadeChunk, kBufferAlign);
+        for(int y = top; y < bottom; y++){
+            const float cy = y + 0.5f;
+            // Each edge bounds the row on one side: x where E(x, cy) == 0. Like clampSpan() for
+            // polygons, spans stop short of the device's last column.
+            float left = 0;
+            float right = w - 1;
+            bool empty = false;
+            for(int i = 0; i < 3; i++){
+                float rowValue = B[i] * cy + C[i];
+                if(A[i] > 0){
+                    left = std::max(left, -rowValue / A[i]);
+                }else if(A[i] < 0){
+                    right = std::min(right, -rowValue / A[i]);
+                }else if(rowValue < 0 || (rowValue == 0 && B[i] < 0)){
+                    empty = true;
+                }
+            }
+            // Centers with left < x + 0.5 <= right
+            int leftX = GRoundToInt(left);
+            int rightX = GRoundToInt(right);
+            if(empty || rightX <= leftX){
+                continue;
+            }
+            float color[4];
+            if(colors != nullptr){
+                const float cx = leftX + 0.5f;
+                float weight1 = A[2] * cx + B[2] * cy + C[2];
+                float weight2 = A[0] * cx + B[0] * cy + C[0];
+                for(int k = 0; k < 4; k++){
+                    color[k] = c0[k] + d1[k] * weight1 + d2[k] * weight2;
+                }
+            }
+            GPixel* dst = this->fDevice.getAddr(leftX, y);
+            for(int x = leftX; x < rightX; x += kShadeChunk){
+                const int count = std::min(rightX - x, (int)kShadeChunk);
+                if(context != nullptr){
+                    context->shadeRow(x, y, count, storage);
+                }
+                for(int i = 0; colors != nullptr && i < count; i++){
+                    // convertSColor, with rounding by truncation since everything is >= 0
+                    float a = GPinToUnit(color[0]) * 255;
+                    GPixel pixel = GPixel_PackARGB((int) (a + 0.5f),
+                                                   (int) (a * GPinToUnit(color[1]) + 0.5f),
+                                                   (int) (a * GPinToUnit(color[2]) + 0.5f),
+                                                   (int) (a * GPinToUnit(color[3]) + 0.5f));
+                    if(context != nullptr){
+                        // Modulate the texture by the color, component by component
+                        GPixel texel = storage[i];
+                        pixel = GPixel_PackARGB(
+                                GRoundToInt((GPixel_GetA(pixel) * GPixel_GetA(texel)) / 255.0f),
+                                GRoundToInt((GPixel_GetR(pixel) * GPixel_GetR(texel)) / 255.0f),
+                                GRoundToInt((GPixel_GetG(pixel) * GPixel_GetG(texel)) / 255.0f),
+                                GRoundToInt((GPixel_GetB(pixel) * GPixel_GetB(texel)) / 255.0f));
+                    }
+                    storage[i] = pixel;
+                    for(int k = 0; k < 4; k++){
+                        color[k] += ddx[k];
+                    }
+                }
+                proc(dst + (x - leftX), storage, count);
+            }
+        }
     }
 
 
@@ -766,63 +1672,50 @@ public:
          */
         virtual void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
                               int count, const int indices[], const GPaint& paint){
+            if(count <= 0){
+                return;
+            }
+            GShader* shader = paint.getShader();
+            if(shader == nullptr){
+                texs = nullptr;
+            }
+            if(colors == nullptr && texs == nullptr){
+                // Draw nothing
+                return;
+            }
+            bool opaque = texs == nullptr || shader->isOpaque();
+            for(int i = 0; colors != nullptr && opaque && i < count * 3; i++){
+                opaque = colors[indices[i]].fA >= 1;
+            }
+            GBlendMode mode = reduceBlendMode(paint.getBlendMode(), opaque, false);
+            if(mode == GBlendMode::kDst){
+                return;
+            }
+            BlendRowProc proc = gBlendRowProcs[static_cast<int>(mode)];
+
+            // Map every vertex once, however many triangles share it
+            GArenaScope scope(&fArena);
+            const int vertexCount = 1 + *std::max_element(indices, indices + count * 3);
+            GPoint* devVerts = fArena.makeArray<GPoint>(vertexCount);
+            ctm.mapPoints(devVerts, verts, vertexCount);
 
             int n = 0;
             for (int i = 0; i < count; ++i) {
-                if (texs != nullptr && colors == nullptr) {
-                    GPoint point0 = verts[indices[n + 0]];
-                    GPoint point1 = verts[indices[n + 1]];
-                    GPoint point2 = verts[indices[n + 2]];
-
-                    GPoint pts1[] = {point0, point1, point2};
-
-                    GPoint texs0 = texs[indices[n + 0]];
-                    GPoint texs1 = texs[indices[n + 1]];
-                    GPoint texs2 = texs[indices[n + 2]];
-
-                    GPoint texture[] = {texs0, texs1, texs2};
-
-                    drawTriangleWithTex(pts1, texture, paint);
-                } else if (colors != nullptr && texs == nullptr) {
-                    //TODO: draw triangle with colors
-
-                    GPoint point0 = verts[indices[n+0]];
-                    GPoint point1 = verts[indices[n+1]];
-                    GPoint point2 = verts[indices[n+2]];
-
-                    GPoint pts2[] = {point0, point1, point2};
-
-                    GColor color0 = colors[indices[n+0]];
-                    GColor color1 = colors[indices[n+1]];
-                    GColor color2 = colors[indices[n+2]];
-
-                    GColor clr[] = {color0, color1, color2};
-
-                    drawTriangleWithColor(pts2, clr, paint);
-                } else if(colors != nullptr && texs != nullptr) {
-                    //TODO: draw triangle with colors and texs
-                    GPoint point0 = verts[indices[n + 0]];
-                    GPoint point1 = verts[indices[n + 1]];
-                    GPoint point2 = verts[indices[n + 2]];
-
-                    GPoint pts3[] = {point0, point1, point2};
-
-                    GColor color0 = colors[indices[n + 0]];
-                    GColor color1 = colors[indices[n + 1]];
-                    GColor color2 = colors[indices[n + 2]];
-
-                    GColor clr2[] = {color0, color1, color2};
-
-                    GPoint texs0 = texs[indices[n + 0]];
-                    GPoint texs1 = texs[indices[n + 1]];
-                    GPoint texs2 = texs[indices[n + 2]];
-
-                    GPoint texture2[] = {texs0, texs1, texs2};
-
-                    drawTriangleWithBoth(pts3, clr2, texture2, paint);
-                } else {
-                    // Draw nothing
+                GPoint pts[] = {verts[indices[n + 0]], verts[indices[n + 1]], verts[indices[n + 2]]};
+                GPoint devPts[] = {devVerts[indices[n + 0]], devVerts[indices[n + 1]],
+                                   devVerts[indices[n + 2]]};
+                GColor clr[3];
+                GPoint texture[3];
+                for (int k = 0; k < 3; ++k) {
+                    if (colors != nullptr) {
+                        clr[k] = colors[indices[n + k]];
+                    }
+                    if (texs != nullptr) {
+                        texture[k] = texs[indices[n + k]];
+                    }
                 }
+                fillTriangle(pts, devPts, colors ? clr : nullptr, texs ? texture : nullptr, shader,
+                             proc);
                 n+=3;
             }
         }
@@ -872,91 +1765,367 @@ public:
          */
         virtual void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
                               int level, const GPaint& paint) {
-            /*GPoint p0 = verts[0];
-            GPoint p1 = verts[1];
-            GPoint p2 = verts[2];
-            GPoint p3 = verts[3];
-
-            for (int i = 0; i < level + 1; i++) {
-                for (int j = 0; j < level + 1; j++) {
+            // Evaluate the (n + 1)^2 grid of shared vertices once, at u = i / n and v = j / n
+            const int n = std::max(level + 1, 1);
+            const int side = n + 1;
+            fQuadVerts.resize(side * side);
+            fQuadColors.resize(colors ? side * side : 0);
+            fQuadTexs.resize(texs ? side * side : 0);
+            for (int j = 0; j <= n; j++) {
+                float v = (float) j / n;
+                for (int i = 0; i <= n; i++) {
+                    float u = (float) i / n;
+                    fQuadVerts[j * side + i] = makePoint(verts, u, v);
+                    if (colors) {
+                        fQuadColors[j * side + i] = makeColor(colors, u, v);
+                    }
+                    if (texs) {
+                        fQuadTexs[j * side + i] = makePoint(texs, u, v);
+                    }
+                }
+            }
 
+            // Two triangles per cell, split on the top-right --> bottom-left diagonal
+            fQuadIndices.resize(n * n * 6);
+            int* indices = fQuadIndices.data();
+            for (int j = 0; j < n; j++) {
+                for (int i = 0; i < n; i++) {
+                    int topLeft = j * side + i;
+                    int topRight = topLeft + 1;
+                    int bottomLeft = topLeft + side;
+                    int bottomRight = bottomLeft + 1;
+                    *indices++ = topLeft;
+                    *indices++ = topRight;
+                    *indices++ = bottomLeft;
+                    *indices++ = bottomLeft;
+                    *indices++ = bottomRight;
+                    *indices++ = topRight;
                 }
-            }*/
+            }
 
-            int indices[6] = {0, 1, 3, 3, 2, 1};
-            GPoint updatedVerts[4];
-            GColor updatedColor[4];
-            GPoint updatedTexs[4];
+            this->drawMesh(fQuadVerts.data(), colors ? fQuadColors.data() : nullptr,
+                           texs ? fQuadTexs.data() : nullptr, n * n * 2, fQuadIndices.data(), paint);
+        }
 
-            enum{
-                containsTex = 1 << 1,
-                containsColor = 1 << 0,
-            };
 
-            int flag = 0;
 
-            if(texs){
-                flag |= containsTex;
-            }
-            if (colors){
-                flag |= containsColor;
-            }
+private:
+    GBitmap fDevice;
+    GMatrix ctm = GMatrix();
+    // Rows this canvas may write, see setClipRows()
+    int fClipTop;
+    int fClipBottom;
+    // Per-draw scratch (edges, mapped points, row buffers, shader contexts), rewound at the end
+    // of each draw so that steady-state drawing doesn't allocate
+    GArena fArena;
+    // Anti-aliasing's coverage accumulator, all zero between draws
+    std::vector<float> fCoverage;
+    // drawPath's masks, and the one being rasterized
+    PathMaskCache fMaskCache;
+    PathMask fScratchMask;
+    // drawQuad's tessellation, kept to reuse the storage
+    std::vector<GPoint> fQuadVerts;
+    std::vector<GColor> fQuadColors;
+    std::vector<GPoint> fQuadTexs;
+    std::vector<int> fQuadIndices;
+};
 
+// Records the draws of a frame, bins them into horizontal bands of the device by the rows they
+// can touch, and replays each band on the thread pool. A band is drawn by one MyCanvas limited to
+// those rows, in recording order, and geometry is still computed against the whole device, so the
+// result is bit-identical to drawing with a single MyCanvas. Bands span the full width so a span
+// is never split and shaders step across it exactly as they would single-threaded.
+class MyTiledCanvas : public GCanvas {
+public:
+    enum {
+        kTileHeight = 32,
+    };
 
-            float stride = 1.0 / (level + 1);
-            float u;
-            float v = 0.0;
+    MyTiledCanvas(const GBitmap& device, int threadCount)
+            : fDevice(device), fPool(threadCount - 1),
+              fBins((device.height() + kTileHeight - 1) / kTileHeight) {
+        for(int i = 0; i < fPool.workerCount(); i++){
+            fWorkers.emplace_back(new MyCanvas(device));
+        }
+    }
 
-            bool updateTexs;
-            bool updateColor;
+    ~MyTiledCanvas() override {
+        this->flush();
+    }
 
-            while (v < 1){
-                u = 0.0;
-                while (u < 1){
-                    updateTexs = false;
-                    updateColor = false;
+    void save() override {
+        fSaved.push_back(fCTM);
+    }
 
-                    updatedVerts[0] = makePoint(verts, u, v);
-                    updatedVerts[1] = makePoint(verts, u + stride, v);
-                    updatedVerts[2] = makePoint(verts, u + stride, v + stride);
-                    updatedVerts[3] = makePoint(verts, u, v + stride);
+    void restore() override {
+        if(fSaved.empty() == false){
+            fCTM = fSaved.back();
+            fSaved.pop_back();
+        }
+    }
 
-                    if (flag & containsTex){
-                        updatedTexs[0] = makePoint(texs, u, v);
-                        updatedTexs[1] = makePoint(texs, u + stride, v);
-                        updatedTexs[2] = makePoint(texs, u + stride, v + stride);
-                        updatedTexs[3] = makePoint(texs, u, v + stride);
+    void concat(const GMatrix& matrix) override {
+        fCTM.setConcat(fCTM, matrix);
+    }
 
-                        updateTexs = true;
-                    }
+    void drawPaint(const GPaint& paint) override {
+        Draw* draw = this->newDraw(Draw::kPaint, paint);
+        this->record(draw, 0, fDevice.height());
+    }
 
-                    if (flag & containsColor){
-                        updatedColor[0] = makeColor(colors, u, v);
-                        updatedColor[1] = makeColor(colors, u + stride, v);
-                        updatedColor[2] = makeColor(colors, u + stride, v + stride);
-                        updatedColor[3] = makeColor(colors, u, v + stride);
-                        updateColor = true;
-                    }
+    void drawRect(const GRect& rect, const GPaint& paint) override {
+        Draw* draw = this->newDraw(Draw::kRect, paint);
+        draw->fRect = rect;
+        GPoint corners[4] = {{rect.fLeft, rect.fTop}, {rect.fRight, rect.fTop},
+                             {rect.fRight, rect.fBottom}, {rect.fLeft, rect.fBottom}};
+        this->recordPoints(draw, corners, 4);
+    }
 
-                    if (updateTexs == true && updateColor == true){
-                        this->drawMesh(updatedVerts, updatedColor, updatedTexs, 2, indices, paint);
-                    } else if (updateTexs == true) {
-                        this->drawMesh(updatedVerts, colors, updatedTexs, 2, indices, paint);
-                    } else {
-                        this->drawMesh(updatedVerts, updatedColor, texs, 2, indices, paint);
-                    }
+    void drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) override {
+        if(count <= 0){
+            return;
+        }
+        Draw* draw = this->newDraw(Draw::kPolygon, paint);
+        draw->fPts.assign(points, points + count);
+        this->recordPoints(draw, points, count);
+    }
 
-                    u += stride;
-                }
-                v += stride;
-            }
+    void drawPath(const GPath& path, const GPaint& paint) override {
+        Draw* draw = this->newDraw(Draw::kPath, paint);
+        draw->fPath = path;
+        // Work out the path's convexity now: the bands' threads all draw it, and may only read it
+        draw->fPath.isConvex();
+        GRect bounds = path.bounds();
+        GPoint corners[4] = {{bounds.fLeft, bounds.fTop}, {bounds.fRight, bounds.fTop},
+                             {bounds.fRight, bounds.fBottom}, {bounds.fLeft, bounds.fBottom}};
+        this->recordPoints(draw, corners, 4);
+    }
+
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+                  int count, const int indices[], const GPaint& paint) override {
+        if(count <= 0){
+            return;
+        }
+        // Only the paint's shader is borrowed; meshes without texs never touch it
+        GPaint meshPaint = paint;
+        if(texs == nullptr){
+            meshPaint.setShader(nullptr);
         }
+        Draw* draw = this->newDraw(Draw::kMesh, meshPaint);
+        int vertexCount = 1 + *std::max_element(indices, indices + count * 3);
+        draw->fPts.assign(verts, verts + vertexCount);
+        if(colors != nullptr){
+            draw->fColors.assign(colors, colors + vertexCount);
+        }
+        if(texs != nullptr){
+            draw->fTexs.assign(texs, texs + vertexCount);
+        }
+        draw->fIndices.assign(indices, indices + count * 3);
+        draw->fCount = count;
+        this->recordPoints(draw, verts, vertexCount);
+    }
 
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                  int level, const GPaint& paint) override {
+        GPaint quadPaint = paint;
+        if(texs == nullptr){
+            quadPaint.setShader(nullptr);
+        }
+        Draw* draw = this->newDraw(Draw::kQuad, quadPaint);
+        draw->fPts.assign(verts, verts + 4);
+        if(colors != nullptr){
+            draw->fColors.assign(colors, colors + 4);
+        }
+        if(texs != nullptr){
+            draw->fTexs.assign(texs, texs + 4);
+        }
+        draw->fLevel = level;
+        this->recordPoints(draw, verts, 4);
+    }
 
+    void drawBitmap(const GBitmap& bitmap, float x, float y, const GPaint& paint) override {
+        GPaint bitmapPaint = paint;
+        bitmapPaint.setShader(nullptr);
+        Draw* draw = this->newDraw(Draw::kBitmap, bitmapPaint);
+        draw->fBitmap = bitmap;
+        draw->fRect = GRect::MakeXYWH(x, y, bitmap.width(), bitmap.height());
+        GPoint corners[4] = {{draw->fRect.fLeft, draw->fRect.fTop},
+                             {draw->fRect.fRight, draw->fRect.fTop},
+                             {draw->fRect.fRight, draw->fRect.fBottom},
+                             {draw->fRect.fLeft, draw->fRect.fBottom}};
+        this->recordPoints(draw, corners, 4);
+    }
+
+    void flush() override {
+        std::vector<int> bands;
+        for(size_t i = 0; i < fBins.size(); i++){
+            if(fBins[i].empty() == false){
+                bands.push_back((int)i);
+            }
+        }
+        fPool.parallelFor((int)bands.size(), [this, &bands](int task, int worker) {
+            int band = bands[task];
+            MyCanvas* canvas = fWorkers[worker].get();
+            canvas->setClipRows(band * kTileHeight, (band + 1) * kTileHeight);
+            for(int index : fBins[band]){
+                replay(canvas, fDraws[index]);
+            }
+        });
+        fDraws.clear();
+        for(std::vector<int>& bin : fBins){
+            bin.clear();
+        }
+    }
 
 private:
-    GBitmap fDevice;
-    GMatrix ctm = GMatrix();
+    struct Draw {
+        enum Type { kPaint, kRect, kPolygon, kPath, kMesh, kQuad, kBitmap };
+
+        Type                fType;
+        GMatrix             fCTM;
+        GPaint              fPaint;
+        GRect               fRect;
+        GPath               fPath;
+        GBitmap             fBitmap;
+        std::vector<GPoint> fPts;
+        std::vector<GColor> fColors;
+        std::vector<GPoint> fTexs;
+        std::vector<int>    fIndices;
+        int                 fCount = 0;
+        int                 fLevel = 0;
+    };
+
+    static void replay(MyCanvas* canvas, const Draw& draw) {
+        canvas->setMatrix(draw.fCTM);
+        const GColor* colors = draw.fColors.empty() ? nullptr : draw.fColors.data();
+        const GPoint* texs = draw.fTexs.empty() ? nullptr : draw.fTexs.data();
+        switch(draw.fType){
+            case Draw::kPaint:
+                canvas->drawPaint(draw.fPaint);
+                break;
+            case Draw::kRect:
+                canvas->drawRect(draw.fRect, draw.fPaint);
+                break;
+            case Draw::kPolygon:
+                canvas->drawConvexPolygon(draw.fPts.data(), (int)draw.fPts.size(), draw.fPaint);
+                break;
+            case Draw::kPath:
+                canvas->drawPath(draw.fPath, draw.fPaint);
+                break;
+            case Draw::kMesh:
+                canvas->drawMesh(draw.fPts.data(), colors, texs, draw.fCount,
+                                 draw.fIndices.data(), draw.fPaint);
+                break;
+            case Draw::kQuad:
+                canvas->drawQuad(draw.fPts.data(), colors, texs, draw.fLevel, draw.fPaint);
+                break;
+            case Draw::kBitmap:
+                canvas->drawBitmap(draw.fBitmap, draw.fRect.fLeft, draw.fRect.fTop, draw.fPaint);
+                break;
+        }
+    }
+
+    Draw* newDraw(Draw::Type type, const GPaint& paint) {
+        fDraws.emplace_back();
+        Draw* draw = &fDraws.back();
+        draw->fType = type;
+        draw->fCTM = fCTM;
+        draw->fPaint = paint;
+        return draw;
+    }
+
+    // Bin the draw by the device rows its mapped points can reach. Padding by a row on each side
+    // covers pixel-center rounding.
+    void recordPoints(Draw* draw, const GPoint points[], int count) {
+        float minY = INFINITY;
+        float maxY = -INFINITY;
+        for(int i = 0; i < count; i++){
+            float y = fCTM.mapPt(points[i]).fY;
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+        }
+        if(!(minY >= -fDevice.height() && maxY <= 2 * fDevice.height())){
+            // far off-device or not finite: let every band decide row by row
+            this->record(draw, 0, fDevice.height());
+            return;
+        }
+        this->record(draw, GFloorToInt(minY) - 1, GCeilToInt(maxY) + 1);
+    }
+
+    void record(Draw* draw, int top, int bottom) {
+        top = std::max(top, 0);
+        bottom = std::min(bottom, fDevice.height());
+        if(top >= bottom){
+            fDraws.pop_back();
+            return;
+        }
+        if(draw->fPaint.getShader() != nullptr || draw->fType == Draw::kBitmap){
+            // The shader or the bitmap's pixels may not outlive this call, so draw now, after
+            // everything before it
+            Draw now = std::move(*draw);
+            fDraws.pop_back();
+            this->flush();
+            this->drawNow(now, top, bottom);
+            return;
+        }
+        int index = (int)fDraws.size() - 1;
+        for(int band = top / kTileHeight; band * kTileHeight < bottom; band++){
+            fBins[band].push_back(index);
+        }
+    }
+
+    // Draw one draw across the bands of [top, bottom) in parallel. Unless the draw builds its own
+    // shaders per triangle (meshes), a shader's context is made once here and shared by all
+    // the bands.
+    void drawNow(Draw& draw, int top, int bottom) {
+        GArenaScope scope(&fArena);
+        GShader* shader = draw.fPaint.getShader();
+        SharedContextShader shared(shader);
+        if(shader != nullptr && draw.fType != Draw::kMesh && draw.fType != Draw::kQuad){
+            GShader::Context* context = shader->makeContext(draw.fCTM, &fArena);
+            if(context == nullptr){
+                return;
+            }
+            shared.fContext = context;
+            draw.fPaint.setShader(&shared);
+        }
+        int firstBand = top / kTileHeight;
+        int bandCount = (bottom - 1) / kTileHeight - firstBand + 1;
+        fPool.parallelFor(bandCount, [this, &draw, firstBand, top, bottom](int task, int worker) {
+            int band = firstBand + task;
+            MyCanvas* canvas = fWorkers[worker].get();
+            canvas->setClipRows(std::max(band * kTileHeight, top),
+                                std::min((band + 1) * kTileHeight, bottom));
+            replay(canvas, draw);
+        });
+    }
+
+    // Stands in for the paint's shader while a draw is replayed, handing every band the context
+    // that was made for the whole draw
+    class SharedContextShader : public GShader {
+    public:
+        SharedContextShader(GShader* shader) : fShader(shader), fContext(nullptr) {}
+
+        bool isOpaque() override {
+            return fShader->isOpaque();
+        }
+
+        Context* makeContext(const GMatrix&, GArena*) override {
+            return fContext;
+        }
+
+        GShader*    fShader;
+        Context*    fContext;
+    };
+
+    GBitmap                                 fDevice;
+    GMatrix                                 fCTM;
+    std::vector<GMatrix>                    fSaved;
+    std::deque<Draw>                        fDraws;
+    ThreadPool                              fPool;
+    std::vector<std::vector<int>>           fBins;
+    std::vector<std::unique_ptr<MyCanvas>>  fWorkers;
+    GArena                                  fArena;
 };
 
 void GDrawSomething_polys(GCanvas* canvas){
@@ -1006,4 +2175,19 @@ std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& device) {
         return nullptr;
     }
     return std::unique_ptr<GCanvas>(new MyCanvas(device));
-}
\ No newline at end of file
+}
+
+std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& device, int threadCount) {
+    if (!device.pixels()) {
+        return nullptr;
+    }
+    if (threadCount <= 1) {
+        return std::unique_ptr<GCanvas>(new MyCanvas(device));
+    }
+    return std::unique_ptr<GCanvas>(new MyTiledCanvas(device, threadCount));
+}
+
+GPathMaskCacheStats GGetPathMaskCacheStats() {
+    return { gPathMaskCounters.fHits, gPathMaskCounters.fMisses, gPathMaskCounters.fEvictions,
+             gPathMaskCounters.fBytes };
+}
@@ -3,16 +3,30 @@
 #include "GColor.h"
 #include "GMath.h"
 #include <stdio.h>
+#include <stdint.h>
 
 class MyLinearGradientShader : public GShader {
 public:
+	enum {
+		// Entry i holds the color at t = i / (kTableSize - 1)
+		kTableSize = 1024,
+	};
+
 	MyLinearGradientShader(GPoint p0, GPoint p1, const GColor colors[], int count, GShader::TileMode mode){
-		 fColors = new GColor[count];
-		 // memory copy
-		 memcpy(fColors, colors, count * sizeof(GColor));
-		 fLocalMatrix = GMatrix(p1.fX - p0.fX, p0.fY - p1.fY, p0.fX, p1.fY - p0.fY, p1.fX - p0.fX, p0.fY);
-		 fCount = count;
+		fLocalMatrix = GMatrix(p1.fX - p0.fX, p0.fY - p1.fY, p0.fX, p1.fY - p0.fY, p1.fX - p0.fX, p0.fY);
 		fTileMode = mode;
+		// Return true if all elements in colors are opaque
+		fIsOpaque = true;
+		for(int i = 0; i < count; i++){
+			if(colors[i].fA < 1){
+				fIsOpaque = false;
+			}
+		}
+		// Bake the stops into premultiplied pixels once; shading only indexes this table
+		for(int i = 0; i < kTableSize; i++){
+			fTable[i] = count == 1 ? convertSColor(colors[0])
+			                       : interpolate(colors, count, (float) i / (kTableSize - 1));
+		}
 	}
 
 
@@ -28,101 +42,115 @@ public:
 		return GPixel_PackARGB(a, r, g, b);
 	}
 
-	bool isOpaque() override {
-		// Return true if all elements in colors are opaque
-		for(int i = 0; i < fCount; i++){
-			if(fColors[i].fA == 0){
-				return false;
+	// The premultiplied color at localX in [0, 1]
+	static GPixel interpolate(const GColor colors[], int count, float localX){
+		// find the two color to be combined
+		int colorOne = 0;
+		int colorTwo = 1;
+		float bound = 1.0 / (count-1);
+		for(int i = 0; i < count - 1; i++){
+			if(bound * colorOne <= localX && localX <= bound * colorTwo){
+				break;
 			}
+			colorOne = colorOne + 1;
+			colorTwo = colorTwo + 1;
 		}
-		return true;
+		// Correct localX by weight
+		float adjustedLocalX = (localX - bound * colorOne) / bound;
+
+		// interpolate alph, red, green and blue
+		float pinnedAlpha = GPinToUnit((1 - adjustedLocalX) * colors[colorOne].fA + adjustedLocalX * colors[colorTwo].fA);
+		float pinnedRed = GPinToUnit((1 - adjustedLocalX) * colors[colorOne].fR + adjustedLocalX * colors[colorTwo].fR);
+		float pinnedGreen = GPinToUnit((1 - adjustedLocalX) * colors[colorOne].fG + adjustedLocalX * colors[colorTwo].fG);
+		float pinnedBlue = GPinToUnit((1 - adjustedLocalX) * colors[colorOne].fB + adjustedLocalX * colors[colorTwo].fB);
+
+		int roundedAlpha = GRoundToInt(255 * pinnedAlpha);
+		int roundedRed = GRoundToInt(255 * pinnedAlpha * pinnedRed);
+		int roundedGreen = GRoundToInt(255 * pinnedAlpha * pinnedGreen);
+		int roundedBlue = GRoundToInt(255 * pinnedAlpha * pinnedBlue);
+
+		return GPixel_PackARGB(roundedAlpha, roundedRed, roundedGreen, roundedBlue);
 	}
 
-	bool setContext(const GMatrix& ctm) override {
-        GMatrix temp = fLocalMatrix;
-        fLocalMatrix.setConcat(ctm, fLocalMatrix);
-        if(!fLocalMatrix.invert(&fInverse)){
-            fLocalMatrix = temp;
-            return false;
-        } else {
-            fLocalMatrix = temp;
-            return true;
-        }
-    }
-
-	void shadeRow(int x, int y, int count, GPixel row[]) override {
-        // Compute local coordinates from device coordinates; we need to add 0.5 to x and y because of rounding issues
-		GPoint local = fInverse.mapXY(x + 0.5, y + 0.5);
-		for (int i = 0; i < count; ++i) {
-			if(fCount != 1){
-                float localX = local.fX;
-				if(fTileMode == GShader::kRepeat){ // repeat
-					localX = localX - GFloorToInt(localX);
+	bool isOpaque() override {
+		return fIsOpaque;
+	}
+
+	Context* makeContext(const GMatrix& ctm, GArena* arena) override {
+		GMatrix total;
+		total.setConcat(ctm, fLocalMatrix);
+		GMatrix inverse;
+		if(!total.invert(&inverse)){
+			return nullptr;
+		}
+		return arena->make<GradientContext>(fTable, inverse, fTileMode);
+	}
+
+private:
+	class GradientContext : public Context {
+	public:
+		GradientContext(const GPixel* table, const GMatrix& inverse, GShader::TileMode mode)
+			: fTable(table), fInverse(inverse), fTileMode(mode) {}
+
+		void shadeRow(int x, int y, int count, GPixel row[]) const override {
+			// t (= local x) at pixel centers in 32.32 fixed point: the row's origin at device x = 0,
+			// mapped in double, plus x steps. Every pixel depends only on its own x and y, so a row
+			// shades the same however it is split into calls.
+			const int64_t dt = ToFixedStep(fInverse[GMatrix::SX]);
+			int64_t t = ToFixed(fInverse[GMatrix::SX] * 0.5 + fInverse[GMatrix::KX] * (y + 0.5) + fInverse[GMatrix::TX])
+			          + (int64_t) x * dt;
+			if(fTileMode == GShader::kClamp){ // clamp
+				for (int i = 0; i < count; ++i) {
+					int64_t u = t < 0 ? 0 : (t > 0xFFFFFFFF ? 0xFFFFFFFF : t);
+					row[i] = fTable[index((uint64_t) u)];
+					t += dt;
+				}
+			} else if(fTileMode == GShader::kRepeat){ // repeat
+				for (int i = 0; i < count; ++i) {
+					row[i] = fTable[index((uint64_t) t & 0xFFFFFFFF)];
+					t += dt;
 				}
-				 else if(fTileMode == GShader::kClamp){ // clamp
-					localX = GPinToUnit(localX);
-				} else if(fTileMode == GShader::kMirror){ // mirror
-					localX *= 0.5;
-					localX = localX - GFloorToInt(localX);
-					if(localX > 0.5){
-						localX = 1 - localX;
+			} else { // mirror: fold the period of 2 back onto [0, 1]
+				for (int i = 0; i < count; ++i) {
+					uint64_t u = (uint64_t) t & 0x1FFFFFFFF;
+					if(u > 0xFFFFFFFF){
+						u = 0x1FFFFFFFF - u;
 					}
-					localX = localX * 2;
+					row[i] = fTable[index(u)];
+					t += dt;
 				}
-                // find the two color to be combined
-                int colorOne = 0;
-                int colorTwo = 1;
-                float bound = 1.0 / (fCount-1);
-                for(int i = 0; i < fCount - 1; i++){
-                    if(bound * colorOne <= localX && localX <= bound * colorTwo){
-                        break;
-                    }
-                    colorOne = colorOne + 1;
-                    colorTwo = colorTwo + 1;
-                }
-                // Correct localX by weight
-                float adjustedLocalX = (localX - bound * colorOne) / bound;
-
-                // interpolate alph, red, green and blue
-                float alphaOne = fColors[colorOne].fA;
-                float alphaTwo = fColors[colorTwo].fA;
-
-                float redOne = fColors[colorOne].fR;
-                float redTwo = fColors[colorTwo].fR;
-
-                float greenOne = fColors[colorOne].fG;
-                float greenTwo = fColors[colorTwo].fG;
-
-                float blueOne = fColors[colorOne].fB;
-                float blueTwo = fColors[colorTwo].fB;
-
-                float pinnedAlpha = GPinToUnit((1 - adjustedLocalX) * alphaOne + adjustedLocalX * alphaTwo);
-                float pinnedRed = GPinToUnit((1 - adjustedLocalX) * redOne + adjustedLocalX * redTwo);
-                float pinnedGreen = GPinToUnit((1 - adjustedLocalX) * greenOne + adjustedLocalX * greenTwo);
-                float pinnedBlue = GPinToUnit((1 - adjustedLocalX) * blueOne + adjustedLocalX * blueTwo);
-
-                int roundedAlpha = GRoundToInt(255 * pinnedAlpha);
-                int roundedRed = GRoundToInt(255 * pinnedAlpha * pinnedRed);
-                int roundedGreen = GRoundToInt(255 * pinnedAlpha * pinnedGreen);
-                int roundedBlue = GRoundToInt(255 * pinnedAlpha * pinnedBlue);
-
-                row[i] = GPixel_PackARGB(roundedAlpha, roundedRed, roundedGreen, roundedBlue);
-			}else{
-                row[i] = convertSColor(fColors[0]);
 			}
-			local.fX += fInverse[GMatrix::SX];
-			local.fY += fInverse[GMatrix::KY];
 		}
-	}
 
-    
+		// t only depends on y through KX
+		bool isRowInvariant() const override {
+			return fInverse[GMatrix::KX] == 0;
+		}
 
+	private:
+		// Positions floor so that t just below a period boundary never reaches it; only the step
+		// rounds to nearest, and its error is below 2^-32 per pixel
+		static int64_t ToFixed(double v) {
+			return (int64_t) floor(v * 4294967296.0);
+		}
 
-private:
-    GColor* fColors;
+		static int64_t ToFixedStep(double v) {
+			return (int64_t) floor(v * 4294967296.0 + 0.5);
+		}
+
+		// Nearest table entry for u in [0, 0xFFFFFFFF] (0xFFFFFFFF being t == 1)
+		static int index(uint64_t u) {
+			return (int) ((u * (kTableSize - 1) + 0x80000000) >> 32);
+		}
+
+		const GPixel* fTable;
+		const GMatrix fInverse;
+		const GShader::TileMode fTileMode;
+	};
+
+    GPixel fTable[kTableSize];
     GMatrix fLocalMatrix;
-    GMatrix fInverse;
-    int fCount;
+    bool fIsOpaque;
     GShader::TileMode fTileMode;
 
 };
@@ -132,4 +160,4 @@ std::unique_ptr<GShader> GCreateLinearGradient(GPoint p0, GPoint p1, const GColo
 		return nullptr;
 	}
 	return std::unique_ptr<GShader> (new MyLinearGradientShader(p0, p1, colors, count, mode));
-}
\ No newline at end of file
+}
@@ -0,0 +1,220 @@
+#ifndef PathMaskCache_DEFINED
+#define PathMaskCache_DEFINED
+
+#include "GPath.h"
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <stdint.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+// A path rasterized under one CTM, as the device-space spans it covers
+struct PathMask {
+    struct Span {
+        int fY;
+        int fLeft;
+        int fRight;
+        // Index of the span's first coverage byte in fCoverage, or -1 when fully covered
+        int fCoverage;
+    };
+
+    std::vector<Span>       fSpans;     // sorted by fY
+    std::vector<uint8_t>    fCoverage;
+
+    void reset() {
+        fSpans.clear();
+        fCoverage.clear();
+    }
+
+    size_t bytes() const {
+        return sizeof(PathMask) + fSpans.size() * sizeof(Span) + fCoverage.size();
+    }
+};
+
+// What a mask depends on: the path, all of the CTM, whether it is anti-aliased, and the rows
+// [fTop, fBottom) it was rasterized for
+struct PathMaskKey {
+    uint64_t    fPathHash;
+    float       fMatrix[6];
+    bool        fAntiAlias;
+    int         fTop;
+    int         fBottom;
+
+    bool operator==(const PathMaskKey& other) const {
+        return fPathHash == other.fPathHash && fAntiAlias == other.fAntiAlias
+            && fTop == other.fTop && fBottom == other.fBottom
+            && std::equal(fMatrix, fMatrix + 6, other.fMatrix);
+    }
+
+    // FNV-1a over the path's verbs and points. Paths whose hashes collide get equal keys: the
+    // cache tells them apart by comparing the paths themselves.
+    static uint64_t HashPath(const GPath& path) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto mix = [&hash](const void* data, size_t size) {
+            const uint8_t* bytes = (const uint8_t*)data;
+            for (size_t i = 0; i < size; ++i) {
+                hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+            }
+        };
+        GPath::Iter iter(path);
+        GPoint pts[GPath::kMaxEdgerPoints];
+        for (GPath::Verb verb; (verb = iter.next(pts)) != GPath::kDone;) {
+            // Iter hands back the previous point too; only the new ones identify the path
+            const int first = verb == GPath::kMove ? 0 : 1;
+            const int count = verb == GPath::kMove ? 1 : (int)verb + 1;
+            mix(&verb, sizeof(verb));
+            mix(pts + first, (count - first) * sizeof(GPoint));
+        }
+        return hash;
+    }
+};
+
+/**
+ *  Least recently used masks, up to a budget of bytes. Each mask keeps a copy of its path, and is
+ *  only found for a path equal to it, so paths whose hashes collide never share a mask.
+ *
+ *  Only keys that miss twice are worth a mask: a path drawn once, or moved every frame, is drawn
+ *  directly, and costs the cache nothing but a slot in a small table of recent misses.
+ */
+class PathMaskCache {
+public:
+    // Totals for every cache in the process
+    struct Counters {
+        std::atomic<uint64_t> fHits{0};
+        std::atomic<uint64_t> fMisses{0};
+        std::atomic<uint64_t> fEvictions{0};
+        std::atomic<uint64_t> fBytes{0};
+    };
+
+    PathMaskCache(size_t budget, Counters* counters)
+            : fBudget(budget), fBytes(0), fCounters(counters) {}
+
+    ~PathMaskCache() {
+        fCounters->fBytes -= fBytes;
+    }
+
+    // The mask for key and path, now the most recently used, or nullptr
+    const PathMask* find(const PathMaskKey& key, const GPath& path) {
+        auto found = fIndex.find(key);
+        if (found == fIndex.end() || !SamePath(found->second->fPath, path)) {
+            fCounters->fMisses++;
+            return nullptr;
+        }
+        fCounters->fHits++;
+        fEntries.splice(fEntries.begin(), fEntries, found->second);
+        return &found->second->fMask;
+    }
+
+    // Whether key, which find() just missed, missed recently too and so should get a mask. The
+    // recent misses are remembered by hash in a fixed table, a few to a set so that paths drawn
+    // every frame don't keep pushing each other out, and this never allocates.
+    bool missedBefore(const PathMaskKey& key) {
+        const size_t hash = KeyHash()(key);
+        size_t* set = fRecentMisses + (hash % kRecentMissSets) * kRecentMissWays;
+        for (int i = 0; i < kRecentMissWays; ++i) {
+            if (set[i] == hash) {
+                return true;
+            }
+        }
+        memmove(set + 1, set, (kRecentMissWays - 1) * sizeof(size_t));
+        set[0] = hash;
+        return false;
+    }
+
+    // Add a copy of path's mask for key, evicting the least recently used masks to stay within the
+    // budget. The caller's mask keeps its buffers to rasterize into again. A mask larger than the
+    // whole budget is not added: returns nullptr.
+    const PathMask* add(const PathMaskKey& key, const GPath& path, const PathMask& mask) {
+        const size_t bytes = mask.bytes()
+                           + path.countPoints() * (sizeof(GPoint) + sizeof(GPath::Verb));
+        if (bytes > fBudget || fIndex.count(key)) {
+            return nullptr;
+        }
+        while (fBytes + bytes > fBudget) {
+            this->evictLast();
+        }
+        fEntries.emplace_front();
+        Entry& entry = fEntries.front();
+        entry.fKey = key;
+        entry.fPath = path;
+        entry.fMask = mask;
+        entry.fBytes = bytes;
+        fIndex[key] = fEntries.begin();
+        fBytes += bytes;
+        fCounters->fBytes += bytes;
+        return &entry.fMask;
+    }
+
+private:
+    enum {
+        kRecentMissSets = 256,
+        kRecentMissWays = 4,
+    };
+
+    struct Entry {
+        PathMaskKey fKey;
+        GPath       fPath;
+        PathMask    fMask;
+        size_t      fBytes;     // the mask and the path's points and verbs
+    };
+
+    // Whether the paths have the same verbs and points
+    static bool SamePath(const GPath& a, const GPath& b) {
+        if (a.countPoints() != b.countPoints()) {
+            return false;
+        }
+        GPath::Iter iterA(a), iterB(b);
+        GPoint ptsA[GPath::kMaxEdgerPoints], ptsB[GPath::kMaxEdgerPoints];
+        for (;;) {
+            const GPath::Verb verb = iterA.next(ptsA);
+            if (iterB.next(ptsB) != verb) {
+                return false;
+            }
+            if (verb == GPath::kDone) {
+                return true;
+            }
+            const int count = verb == GPath::kMove ? 1 : (int)verb + 1;
+            for (int i = 0; i < count; ++i) {
+                if (ptsA[i].fX != ptsB[i].fX || ptsA[i].fY != ptsB[i].fY) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    struct KeyHash {
+        size_t operator()(const PathMaskKey& key) const {
+            uint32_t bits[6];
+            memcpy(bits, key.fMatrix, sizeof(bits));
+            uint64_t hash = key.fPathHash;
+            for (uint32_t b : bits) {
+                hash = (hash ^ b) * 0x100000001b3ull;
+            }
+            hash = (hash ^ (uint32_t)key.fTop) * 0x100000001b3ull;
+            hash = (hash ^ (uint32_t)key.fBottom) * 0x100000001b3ull;
+            return (size_t)(hash ^ key.fAntiAlias);
+        }
+    };
+
+    void evictLast() {
+        const Entry& last = fEntries.back();
+        const size_t bytes = last.fBytes;
+        fIndex.erase(last.fKey);
+        fEntries.pop_back();
+        fBytes -= bytes;
+        fCounters->fBytes -= bytes;
+        fCounters->fEvictions++;
+    }
+
+    // Most recently used first
+    std::list<Entry>                                                    fEntries;
+    std::unordered_map<PathMaskKey, std::list<Entry>::iterator, KeyHash> fIndex;
+    size_t                                                              fRecentMisses[kRecentMissSets * kRecentMissWays] = {};
+    const size_t                                                        fBudget;
+    size_t                                                              fBytes;
+    Counters*                                                           fCounters;
+};
+
+#endif
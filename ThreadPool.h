@@ -0,0 +1,101 @@
+#ifndef ThreadPool_DEFINED
+#define ThreadPool_DEFINED
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that run one parallelFor() at a time. The calling thread works
+// too, so a pool of N threads keeps N + 1 cores busy.
+class ThreadPool {
+public:
+    ThreadPool(int threadCount) : fNext(0), fGeneration(0), fBusy(0), fQuit(false) {
+        for (int i = 0; i < threadCount; ++i) {
+            fThreads.push_back(std::thread([this, i]() { this->workerLoop(i + 1); }));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fQuit = true;
+        }
+        fWake.notify_all();
+        for (std::thread& thread : fThreads) {
+            thread.join();
+        }
+    }
+
+    // Number of distinct worker indices passed to parallelFor's function
+    int workerCount() const { return (int)fThreads.size() + 1; }
+
+    // Call fn(task, worker) for every task in [0, count), handing tasks out in order as threads
+    // free up. worker is in [0, workerCount()) and no two concurrent calls share it, so it can
+    // index per-thread scratch state. Returns once every task has finished.
+    void parallelFor(int count, const std::function<void(int, int)>& fn) {
+        if (fThreads.empty() || count <= 1) {
+            for (int i = 0; i < count; ++i) {
+                fn(i, 0);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fTask = &fn;
+            fCount = count;
+            fNext = 0;
+            fBusy = (int)fThreads.size();
+            fGeneration++;
+        }
+        fWake.notify_all();
+        this->runTasks(0);
+
+        std::unique_lock<std::mutex> lock(fMutex);
+        fDone.wait(lock, [this]() { return fBusy == 0; });
+        fTask = nullptr;
+    }
+
+private:
+    void runTasks(int worker) {
+        for (int i = fNext++; i < fCount; i = fNext++) {
+            (*fTask)(i, worker);
+        }
+    }
+
+    void workerLoop(int worker) {
+        unsigned seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(fMutex);
+                fWake.wait(lock, [this, seen]() { return fQuit || fGeneration != seen; });
+                if (fQuit) {
+                    return;
+                }
+                seen = fGeneration;
+            }
+            this->runTasks(worker);
+            {
+                std::lock_guard<std::mutex> lock(fMutex);
+                fBusy--;
+            }
+            fDone.notify_one();
+        }
+    }
+
+    std::vector<std::thread>    fThreads;
+    std::mutex                  fMutex;
+    std::condition_variable     fWake;
+    std::condition_variable     fDone;
+
+    const std::function<void(int, int)>* fTask = nullptr;
+    int                         fCount = 0;
+    std::atomic<int>            fNext;
+    unsigned                    fGeneration;
+    int                         fBusy;
+    bool                        fQuit;
+};
+
+#endif
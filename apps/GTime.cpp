@@ -6,6 +6,7 @@
 
 #include "GTime.h"
 
+#include <chrono>
 #include <sys/time.h>
 
 GMSec GTime::GetMSec() {
@@ -18,3 +19,7 @@ GMSec GTime::GetMSec() {
     }
 }
 
+GNSec GTime::GetNSec() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
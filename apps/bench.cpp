@@ -6,8 +6,12 @@
 #include "GCanvas.h"
 #include "GBitmap.h"
 #include "GTime.h"
+#include <algorithm>
+#include <map>
+#include <math.h>
 #include <memory>
 #include <string>
+#include <vector>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -63,31 +67,238 @@ enum Mode {
     kOnce,
 };
 
-static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap, Mode mode) {
+enum Format {
+    kText,
+    kJSON,
+    kCSV,
+};
+
+static int gThreadCount = 1;
+static double gTargetMS = 500;   // time to spend measuring each bench
+static double gWarmupMS = 100;   // time to spend warming up first
+static const double kMinSampleMS = 0.5;
+static const int kMinSamples = 10;
+static const int kMaxSamples = 10000;
+
+struct BenchResult {
+    std::string         fName;
+    GISize              fSize;
+    // Each sample times fBatch draws in a row, so even tiny benches stay far above the clock's
+    // resolution; fSamples holds the time per draw, in milliseconds.
+    int                 fBatch;
+    std::vector<double> fSamples;
+    double              fMin, fMedian, fP90, fMean, fStdDev;
+
+    double mpixelsPerSec() const {
+        return fMedian > 0 ? fSize.fWidth * fSize.fHeight / (fMedian * 1000) : 0;
+    }
+};
+
+// Linear interpolation between the closest ranks of sorted[]
+static double percentile(const std::vector<double>& sorted, double p) {
+    double rank = p * (sorted.size() - 1);
+    size_t lo = (size_t)rank;
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (rank - lo) * (sorted[hi] - sorted[lo]);
+}
+
+static void compute_stats(BenchResult* result) {
+    std::vector<double> sorted = result->fSamples;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (double s : sorted) {
+        sum += s;
+    }
+    result->fMean = sum / sorted.size();
+    double var = 0;
+    for (double s : sorted) {
+        var += (s - result->fMean) * (s - result->fMean);
+    }
+    result->fStdDev = sorted.size() > 1 ? sqrt(var / (sorted.size() - 1)) : 0;
+    result->fMin = sorted.front();
+    result->fMedian = percentile(sorted, 0.5);
+    result->fP90 = percentile(sorted, 0.9);
+}
+
+// Milliseconds per draw, over count draws
+static double time_draws(GBenchmark* bench, GCanvas* canvas, int count) {
+    GNSec start = GTime::GetNSec();
+    for (int i = 0; i < count; ++i) {
+        bench->draw(canvas);
+        canvas->flush();
+    }
+    return (GTime::GetNSec() - start) * 1e-6 / count;
+}
+
+static bool handle_proc(GBenchmark* bench, GBitmap* bitmap, Mode mode, BenchResult* result) {
     GISize size = bench->size();
     setup_bitmap(bitmap, size.fWidth, size.fHeight);
 
-    auto canvas = GCreateCanvas(*bitmap);
+    auto canvas = GCreateCanvas(*bitmap, gThreadCount);
     if (!canvas) {
         fprintf(stderr, "failed to create canvas for [%d %d] %s\n",
                 size.fWidth, size.fHeight, bench->name());
-        return 0;
+        return false;
     }
+    result->fName = bench->name();
+    result->fSize = size;
+    result->fBatch = 1;
+    result->fSamples.clear();
 
-    int N = 100;
-    bool forever = false;
     switch (mode) {
         case kNormal: break;
-        case kForever: forever = true; break;
-        case kOnce: N = 1; break;
+        case kForever:
+            for (;;) {
+                time_draws(bench, canvas.get(), 1);
+            }
+        case kOnce:
+            result->fSamples.push_back(time_draws(bench, canvas.get(), 1));
+            compute_stats(result);
+            return true;
+    }
+
+    // Warm up caches, allocators and the thread pool, keeping the fastest draw as the estimate
+    double estimate = time_draws(bench, canvas.get(), 1);
+    GNSec warmupEnd = GTime::GetNSec() + (GNSec)(gWarmupMS * 1e6);
+    do {
+        estimate = std::min(estimate, time_draws(bench, canvas.get(), 1));
+    } while (GTime::GetNSec() < warmupEnd);
+
+    estimate = std::max(estimate, 1e-6);
+    result->fBatch = std::max(1, (int)ceil(kMinSampleMS / estimate));
+    int samples = (int)(gTargetMS / (estimate * result->fBatch));
+    samples = std::max(kMinSamples, std::min(samples, kMaxSamples));
+    for (int i = 0; i < samples; ++i) {
+        result->fSamples.push_back(time_draws(bench, canvas.get(), result->fBatch));
+    }
+    compute_stats(result);
+    return true;
+}
+
+static void print_result(FILE* out, const BenchResult& r, Format format, bool first) {
+    switch (format) {
+        case kText:
+            fprintf(out, "bench: %-14s median %9.4f ms  min %9.4f  p90 %9.4f  stddev %8.4f"
+                    "  %9.1f Mpix/s  (%d x %d)\n", r.fName.c_str(), r.fMedian, r.fMin, r.fP90,
+                    r.fStdDev, r.mpixelsPerSec(), (int)r.fSamples.size(), r.fBatch);
+            break;
+        case kCSV:
+            if (first) {
+                fprintf(out, "name,width,height,threads,samples,batch,"
+                             "min_ms,median_ms,p90_ms,mean_ms,stddev_ms,mpixels_per_sec\n");
+            }
+            fprintf(out, "%s,%d,%d,%d,%d,%d,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g\n", r.fName.c_str(),
+                    r.fSize.fWidth, r.fSize.fHeight, gThreadCount, (int)r.fSamples.size(),
+                    r.fBatch, r.fMin, r.fMedian, r.fP90, r.fMean, r.fStdDev, r.mpixelsPerSec());
+            break;
+        case kJSON:
+            fprintf(out, "%s\n    { \"name\": \"%s\", \"width\": %d, \"height\": %d, "
+                    "\"threads\": %d, \"batch\": %d,\n      \"min_ms\": %.6g, "
+                    "\"median_ms\": %.6g, \"p90_ms\": %.6g, \"mean_ms\": %.6g, "
+                    "\"stddev_ms\": %.6g, \"mpixels_per_sec\": %.6g,\n      \"samples_ms\": [",
+                    first ? "" : ",", r.fName.c_str(), r.fSize.fWidth, r.fSize.fHeight,
+                    gThreadCount, r.fBatch, r.fMin, r.fMedian, r.fP90, r.fMean, r.fStdDev,
+                    r.mpixelsPerSec());
+            for (size_t i = 0; i < r.fSamples.size(); ++i) {
+                fprintf(out, "%s%.6g", i ? ", " : "", r.fSamples[i]);
+            }
+            fprintf(out, "] }");
+            break;
+    }
+}
+
+// Per-draw samples of each bench in a results file written by --format json
+static bool read_baseline(const char path[], std::map<std::string, std::vector<double>>* baseline) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    std::string text;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        text.append(buffer, n);
+    }
+    fclose(f);
+
+    const std::string nameKey = "\"name\": \"";
+    const std::string samplesKey = "\"samples_ms\": [";
+    size_t pos = 0;
+    while ((pos = text.find(nameKey, pos)) != std::string::npos) {
+        pos += nameKey.size();
+        size_t end = text.find('"', pos);
+        size_t samples = text.find(samplesKey, end);
+        if (end == std::string::npos || samples == std::string::npos) {
+            return false;
+        }
+        std::vector<double>& values = (*baseline)[text.substr(pos, end - pos)];
+        const char* p = text.c_str() + samples + samplesKey.size();
+        for (;;) {
+            char* next;
+            double v = strtod(p, &next);
+            if (next == p) {
+                break;
+            }
+            values.push_back(v);
+            p = next + strspn(next, ", \n");
+        }
+        pos = p - text.c_str();
+    }
+    return !baseline->empty();
+}
+
+// One-sided Mann-Whitney U test: the probability of seeing current rank this far above
+// baseline if both came from the same distribution. Uses the normal approximation, corrected
+// for ties and continuity; it is sound for the >= 10 samples a normal run collects.
+static double mann_whitney_slower(const std::vector<double>& baseline,
+                                  const std::vector<double>& current) {
+    const double n1 = baseline.size(), n2 = current.size(), n = n1 + n2;
+    std::vector<std::pair<double, int>> all;
+    for (double v : baseline) { all.push_back({v, 0}); }
+    for (double v : current)  { all.push_back({v, 1}); }
+    std::sort(all.begin(), all.end());
+
+    double rankSum = 0, tieTerm = 0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first) {
+            ++j;
+        }
+        double rank = (i + 1 + j) * 0.5;   // average of ranks i+1 .. j
+        for (size_t k = i; k < j; ++k) {
+            rankSum += all[k].second ? rank : 0;
+        }
+        double t = j - i;
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+    double u = rankSum - n2 * (n2 + 1) / 2;
+    double variance = n1 * n2 / 12 * ((n + 1) - tieTerm / (n * (n - 1)));
+    if (variance <= 0) {
+        return 1;
     }
+    double z = (u - n1 * n2 / 2 - 0.5) / sqrt(variance);
+    return 0.5 * erfc(z / sqrt(2.0));
+}
 
-    GMSec now = GTime::GetMSec();
-    for (int i = 0; i < N || forever; ++i) {
-        bench->draw(canvas.get());
+// Reports, on stderr, how result moved against its baseline samples. Returns false only for a
+// regression: a median slower by more than threshold percent that the test also calls significant.
+static bool compare_to_baseline(const BenchResult& result,
+                                const std::map<std::string, std::vector<double>>& baseline,
+                                double threshold, double alpha) {
+    auto iter = baseline.find(result.fName);
+    if (iter == baseline.end() || iter->second.empty()) {
+        fprintf(stderr, "  %-14s not in baseline\n", result.fName.c_str());
+        return true;
     }
-    GMSec dur = GTime::GetMSec() - now;
-    return dur * 1.0 / N;
+    std::vector<double> sorted = iter->second;
+    std::sort(sorted.begin(), sorted.end());
+    double change = 100 * (result.fMedian / percentile(sorted, 0.5) - 1);
+    double p = mann_whitney_slower(iter->second, result.fSamples);
+    bool regressed = change > threshold && p < alpha;
+    fprintf(stderr, "  %-14s %+7.1f%% vs baseline  (p = %.3g)%s\n", result.fName.c_str(),
+            change, p, regressed ? "  REGRESSION" : "");
+    return !regressed;
 }
 
 static bool is_arg(const char arg[], const char name[]) {
@@ -107,10 +318,14 @@ static bool is_arg(const char arg[], const char name[]) {
 int main(int argc, char** argv) {
     bool verbose = false;
     Mode mode = kNormal;
+    Format format = kText;
     const char* match = NULL;
     const char* report = NULL;
     const char* author = NULL;
     FILE* reportFile = NULL;
+    std::map<std::string, std::vector<double>> baseline;
+    double threshold = 10;   // percent slower, in the median, before we call it a regression
+    double alpha = 0.01;     // and how unlikely that is to be noise
 
     for (int i = 1; i < argc; ++i) {
         if (is_arg(argv[i], "report") && i+2 < argc) {
@@ -129,9 +344,41 @@ int main(int argc, char** argv) {
             match = argv[++i];
         } else if (is_arg(argv[i], "forever")) {
             mode = kForever;
+        } else if (is_arg(argv[i], "threads") && i+1 < argc) {
+            gThreadCount = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--duration") && i+1 < argc) {
+            gTargetMS = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--warmup") && i+1 < argc) {
+            gWarmupMS = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--baseline") && i+1 < argc) {
+            if (!read_baseline(argv[++i], &baseline)) {
+                fprintf(stderr, "can't read baseline results from %s\n", argv[i]);
+                return -1;
+            }
+        } else if (!strcmp(argv[i], "--threshold") && i+1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--alpha") && i+1 < argc) {
+            alpha = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--format") && i+1 < argc) {
+            ++i;
+            if (!strcmp(argv[i], "json")) {
+                format = kJSON;
+            } else if (!strcmp(argv[i], "csv")) {
+                format = kCSV;
+            } else if (!strcmp(argv[i], "text")) {
+                format = kText;
+            } else {
+                fprintf(stderr, "unknown format %s (text, json or csv)\n", argv[i]);
+                return -1;
+            }
         }
     }
 
+    if (format == kJSON) {
+        printf("{ \"benchmarks\": [");
+    }
+    bool first = true;
+    int regressions = 0;
     for (int i = 0; gBenchFactories[i]; ++i) {
         std::unique_ptr<GBenchmark> bench(gBenchFactories[i]());
         const char* name = bench->name();
@@ -140,14 +387,28 @@ int main(int argc, char** argv) {
             continue;
         }
         if (verbose) {
-            printf("image: %s\n", name);
+            fprintf(stderr, "image: %s\n", name);
         }
         
         GBitmap testBM;
-        double dur = handle_proc(bench.get(), name, &testBM, mode);
-        printf("bench: %s %g\n", name, dur);
+        BenchResult result;
+        if (handle_proc(bench.get(), &testBM, mode, &result)) {
+            print_result(stdout, result, format, first);
+            first = false;
+            if (!baseline.empty()) {
+                regressions += !compare_to_baseline(result, baseline, threshold, alpha);
+            }
+        }
+        fflush(stdout);
 
         free(testBM.pixels());
     }
+    if (format == kJSON) {
+        printf("\n] }\n");
+    }
+    if (regressions) {
+        fprintf(stderr, "%d bench(es) regressed against the baseline\n", regressions);
+        return 1;
+    }
     return 0;
 }
@@ -6,9 +6,12 @@
 #include "GCanvas.h"
 #include "GBitmap.h"
 #include "GColor.h"
+#include "GPath.h"
 #include "GRandom.h"
 #include "GRect.h"
+#include "GShader.h"
 #include <string>
+#include <vector>
 
 static GColor rand_color(GRandom& rand, bool forceOpaque = false) {
     GColor c { rand.nextF(), rand.nextF(), rand.nextF(), rand.nextF() };
@@ -150,6 +153,382 @@ public:
     }
 };
 
+// Full-canvas linear gradients in every tile mode, mostly outside [p0, p1]
+class GradientBench : public GBenchmark {
+    enum { W = 512, H = 512 };
+public:
+    const char* name() const override { return "gradient"; }
+    GISize size() const override { return { W, H }; }
+    void draw(GCanvas* canvas) override {
+        const GColor colors[] = { {1, 1, 0, 0}, {0.5f, 0, 1, 0}, {1, 0, 0, 1} };
+        const GShader::TileMode modes[] = { GShader::kClamp, GShader::kRepeat, GShader::kMirror };
+        for (GShader::TileMode mode : modes) {
+            auto shader = GCreateLinearGradient({100, 50}, {180, 120}, colors, 3, mode);
+            GPaint paint(shader.get());
+            for (int i = 0; i < 4; ++i) {
+                canvas->drawRect(GRect::MakeWH(W, H), paint);
+            }
+        }
+    }
+};
+
+// The same number of translucent, shaded pixels on canvases of different widths: with spans
+// shaded and blended in fixed-size chunks, the cost per pixel shouldn't grow with the width
+class ShadeWidthBench : public GBenchmark {
+    enum { kPixels = 1 << 20 };
+    const int   fWidth;
+    std::string fName;
+public:
+    ShadeWidthBench(int width) : fWidth(width), fName("shade_w" + std::to_string(width)) {}
+
+    const char* name() const override { return fName.c_str(); }
+    GISize size() const override { return { fWidth, kPixels / fWidth }; }
+    void draw(GCanvas* canvas) override {
+        const GColor colors[] = { {0.5f, 1, 0, 0}, {0.75f, 0, 1, 0}, {0.5f, 0, 0, 1} };
+        auto shader = GCreateLinearGradient({0, 0}, {97, 31}, colors, 3, GShader::kMirror);
+        canvas->drawRect(GRect::MakeWH(fWidth, kPixels / fWidth), GPaint(shader.get()));
+    }
+};
+
+// The bitmap_tiling image: a minified, rotated texture in repeat and mirror modes
+class BitmapTilingBench : public GBenchmark {
+    GBitmap fBitmap;
+public:
+    BitmapTilingBench() { fBitmap.readFromFile("apps/spock.png"); }
+    ~BitmapTilingBench() override { free(fBitmap.pixels()); }
+
+    const char* name() const override { return "bitmap_tiling"; }
+    GISize size() const override { return { 512, 512 }; }
+    void draw(GCanvas* canvas) override {
+        const GMatrix m = GMatrix::MakeScale(0.25f, 0.25f).postRotate(M_PI/6);
+        auto sh = GCreateBitmapShader(fBitmap, m, GShader::kRepeat);
+        canvas->drawRect(GRect::MakeXYWH(0, 0, 512, 250), GPaint(sh.get()));
+        sh = GCreateBitmapShader(fBitmap, m, GShader::kMirror);
+        canvas->drawRect(GRect::MakeXYWH(0, 262, 512, 250), GPaint(sh.get()));
+    }
+};
+
+// A UI's worth of small gradient- and bitmap-filled rects under a scale+translate CTM, where the
+// per-draw setup costs about as much as the pixels
+class ShadedRectsBench : public GBenchmark {
+    enum { W = 512, H = 512, N = 2000 };
+    GBitmap fBitmap;
+public:
+    ShadedRectsBench() { fBitmap.readFromFile("apps/spock.png"); }
+    ~ShadedRectsBench() override { free(fBitmap.pixels()); }
+
+    const char* name() const override { return "shaded_rects"; }
+    GISize size() const override { return { W, H }; }
+    void draw(GCanvas* canvas) override {
+        const GColor colors[] = { {0.9f, 1, 0, 0}, {0.6f, 0, 0, 1} };
+        auto gradient = GCreateLinearGradient({0, 0}, {40, 0}, colors, 2, GShader::kClamp);
+        auto bitmap = GCreateBitmapShader(fBitmap, GMatrix::MakeScale(0.1f), GShader::kRepeat);
+        GPaint paints[] = { GPaint(gradient.get()), GPaint(bitmap.get()) };
+        paints[1].setBlendMode(GBlendMode::kSrcOver);
+        GRandom rand;
+        canvas->save();
+        canvas->translate(3.5f, 2.25f);
+        canvas->scale(1.5f, 1.5f);
+        for (int i = 0; i < N; ++i) {
+            float x = rand.nextF() * (W / 1.5f - 30), y = rand.nextF() * (H / 1.5f - 20);
+            canvas->drawRect(GRect::MakeXYWH(x, y, 8 + rand.nextF() * 20, 6 + rand.nextF() * 12),
+                             paints[i & 1]);
+        }
+        canvas->restore();
+    }
+};
+
+// Pre-rendered tiles and sprites composited on whole pixels: an opaque 64x64 tile grid, then
+// translucent sprites blended over it
+class SpritesBench : public GBenchmark {
+    enum { W = 512, H = 512, N = 400 };
+    GBitmap fTile, fSprite;
+public:
+    SpritesBench() {
+        fTile.alloc(64, 64);
+        fSprite.alloc(48, 48);
+        GRandom rand;
+        for (int y = 0; y < 64; ++y) {
+            for (int x = 0; x < 64; ++x) {
+                *fTile.getAddr(x, y) = GPixel_PackARGB(0xFF, x * 4, y * 4, rand.nextU() & 0xFF);
+            }
+        }
+        fTile.setIsOpaque(GBitmap::kCompute_IsOpaque);
+        for (int y = 0; y < 48; ++y) {
+            for (int x = 0; x < 48; ++x) {
+                unsigned a = (x * y) & 0xFF;
+                *fSprite.getAddr(x, y) = GPixel_PackARGB(a, a / 2, a, (a * 3) / 4);
+            }
+        }
+        fSprite.setIsOpaque(GBitmap::kCompute_IsOpaque);
+    }
+    ~SpritesBench() override {
+        free(fTile.pixels());
+        free(fSprite.pixels());
+    }
+
+    const char* name() const override { return "sprites"; }
+    GISize size() const override { return { W, H }; }
+    void draw(GCanvas* canvas) override {
+        GPaint paint;
+        for (int y = 0; y < H; y += 64) {
+            for (int x = 0; x < W; x += 64) {
+                canvas->drawBitmap(fTile, x, y, paint);
+            }
+        }
+        GRandom rand;
+        for (int i = 0; i < N; ++i) {
+            canvas->drawBitmap(fSprite, (int)(rand.nextF() * (W + 48)) - 48,
+                               (int)(rand.nextF() * (H + 48)) - 48, paint);
+        }
+    }
+};
+
+// Thousands of small triangles: a 64x64-cell grid with per-vertex colors, then textured
+class MeshBench : public GBenchmark {
+    enum { W = 512, H = 512, N = 64 };
+    std::vector<GPoint> fVerts;
+    std::vector<GColor> fColors;
+    std::vector<GPoint> fTexs;
+    std::vector<int>    fIndices;
+public:
+    MeshBench() {
+        GRandom rand;
+        for (int j = 0; j <= N; ++j) {
+            for (int i = 0; i <= N; ++i) {
+                fVerts.push_back({ i * (float)W / N, j * (float)H / N });
+                fColors.push_back(rand_color(rand));
+                fTexs.push_back({ (float)i, (float)j });
+            }
+        }
+        for (int j = 0; j < N; ++j) {
+            for (int i = 0; i < N; ++i) {
+                int v = j * (N + 1) + i;
+                int tris[] = { v, v + 1, v + N + 2, v, v + N + 2, v + N + 1 };
+                fIndices.insert(fIndices.end(), tris, tris + 6);
+            }
+        }
+    }
+
+    const char* name() const override { return "mesh"; }
+    GISize size() const override { return { W, H }; }
+    void draw(GCanvas* canvas) override {
+        const GColor stops[] = { {1, 1, 0, 0}, {1, 0, 0, 1} };
+        auto shader = GCreateLinearGradient({0, 0}, {3, 2}, stops, 2, GShader::kMirror);
+        canvas->drawMesh(fVerts.data(), fColors.data(), nullptr, N * N * 2, fIndices.data(),
+                         GPaint());
+        canvas->drawMesh(fVerts.data(), nullptr, fTexs.data(), N * N * 2, fIndices.data(),
+                         GPaint(shader.get()));
+    }
+};
+
+// A finely tessellated quad with colors and texture, like spock_quad
+class QuadBench : public GBenchmark {
+    enum { W = 512, H = 512 };
+public:
+    const char* name() const override { return "quad"; }
+    GISize size() const override { return { W, H }; }
+    void draw(GCanvas* canvas) override {
+        const GColor stops[] = { {1, 1, 0, 0}, {1, 0, 0, 1} };
+        auto shader = GCreateLinearGradient({0, 0}, {30, 20}, stops, 2, GShader::kMirror);
+        const GPoint verts[] = { {20, 40}, {480, 10}, {500, 490}, {30, 430} };
+        const GColor colors[] = { {1, 1, 0, 0}, {1, 0, 1, 0}, {1, 0, 0, 1}, {0.5f, 1, 1, 1} };
+        const GPoint texs[] = { {0, 0}, {100, 0}, {100, 100}, {0, 100} };
+        canvas->drawQuad(verts, colors, texs, 60, GPaint(shader.get()));
+    }
+};
+
+// Forwards every draw to another canvas with anti-aliasing turned on, so recorded scenes (which
+// make their own paints) can be timed both ways
+class AntiAliasCanvas : public GCanvas {
+public:
+    AntiAliasCanvas(GCanvas* canvas) : fCanvas(canvas) {}
+
+    void save() override { fCanvas->save(); }
+    void restore() override { fCanvas->restore(); }
+    void concat(const GMatrix& m) override { fCanvas->concat(m); }
+    void drawPaint(const GPaint& p) override { fCanvas->drawPaint(p); }
+    void drawRect(const GRect& r, const GPaint& p) override { fCanvas->drawRect(r, aa(p)); }
+    void drawConvexPolygon(const GPoint pts[], int count, const GPaint& p) override {
+        fCanvas->drawConvexPolygon(pts, count, aa(p));
+    }
+    void drawPath(const GPath& path, const GPaint& p) override { fCanvas->drawPath(path, aa(p)); }
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count,
+                  const int indices[], const GPaint& p) override {
+        fCanvas->drawMesh(verts, colors, texs, count, indices, p);
+    }
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level,
+                  const GPaint& p) override {
+        fCanvas->drawQuad(verts, colors, texs, level, p);
+    }
+    void flush() override { fCanvas->flush(); }
+
+private:
+    static GPaint aa(const GPaint& p) { return GPaint(p).setAntiAlias(true); }
+
+    GCanvas* fCanvas;
+};
+
+// Whole 512x512 path scenes, the same frames as the lion and cartman images
+class LionBench : public GBenchmark {
+    const bool fAA;
+public:
+    LionBench(bool aa) : fAA(aa) {}
+
+    const char* name() const override { return fAA ? "lion_aa" : "lion"; }
+    GISize size() const override { return { 512, 512 }; }
+    void draw(GCanvas* target) override {
+        AntiAliasCanvas aaCanvas(target);
+        GCanvas* canvas = fAA ? &aaCanvas : target;
+        canvas->save();
+        canvas->translate(130, 40);
+        canvas->scale(1.2, 1.2);
+#include "lion.inc"
+        canvas->restore();
+    }
+};
+
+// The lion zoomed in 8x and scrolling a few pixels every frame, so each frame rasterizes its
+// paths anew and most of them, or most of their curves, are off the device
+class ZoomedLionBench : public GBenchmark {
+    int fFrame = 0;
+public:
+    const char* name() const override { return "lion_zoomed"; }
+    GISize size() const override { return { 512, 512 }; }
+    void draw(GCanvas* canvas) override {
+        const int step = fFrame++ % 64;
+        canvas->save();
+        canvas->translate(-1200 + step * 3, -900 + step * 2);
+        canvas->scale(8, 8);
+#include "lion.inc"
+        canvas->restore();
+    }
+};
+
+// Curve-heavy paths, nudged by a fraction of a pixel every frame so each frame flattens and
+// rasterizes them anew instead of reusing cached masks. With fSlivers the paths are thin wavy
+// strips, thousands of curves covering few pixels; otherwise the cubic_fan and rings images.
+class CurvesBench : public GBenchmark {
+    const bool  fSlivers;
+    int         fFrame = 0;
+public:
+    CurvesBench(bool slivers) : fSlivers(slivers) {}
+
+    const char* name() const override { return fSlivers ? "curve_slivers" : "curves"; }
+    GISize size() const override { return { 512, 512 }; }
+    void draw(GCanvas* canvas) override {
+        const float nudge = (fFrame++ % 100) * 0.01f;
+        GRandom rand;
+        if (fSlivers) {
+            for (int row = 0; row < 32; ++row) {
+                const float y = 8 + row * 16 + nudge;
+                GPath sliver;
+                sliver.moveTo(0, y);
+                for (int i = 0; i < 32; ++i) {
+                    sliver.cubicTo(i * 16 + 5, y - 12, i * 16 + 11, y + 12, i * 16 + 16, y);
+                }
+                for (int i = 31; i >= 0; --i) {
+                    sliver.cubicTo(i * 16 + 11, y + 13, i * 16 + 5, y - 11, i * 16, y + 1);
+                }
+                canvas->drawPath(sliver, GPaint(rand_color(rand, true)));
+            }
+            return;
+        }
+        GPath fan;
+        fan.moveTo(10, 0).cubicTo(100, 100, 100, -120, 200, 0);
+        canvas->save();
+        canvas->translate(256 + nudge, 256);
+        for (int i = 0; i < 29; ++i) {
+            canvas->save();
+            canvas->rotate(2 * M_PI * i / 29);
+            canvas->drawPath(fan, GPaint(rand_color(rand, true)));
+            canvas->restore();
+        }
+        canvas->restore();
+        for (int i = 0; i < 20; ++i) {
+            const float r = 10 + rand.nextF() * 400;
+            GPath ring;
+            ring.addCircle({0, 0}, r, GPath::kCW_Direction);
+            ring.addCircle({0, 0}, r * .75f, GPath::kCCW_Direction);
+            canvas->save();
+            canvas->translate(rand.nextF() * 512 + nudge, rand.nextF() * 512);
+            canvas->drawPath(ring, GPaint(rand_color(rand)));
+            canvas->restore();
+        }
+    }
+};
+
+// Single-contour convex paths (circles, rects and polygons), nudged a fraction of a pixel every
+// frame like CurvesBench so each frame rasterizes them anew
+class ConvexPathsBench : public GBenchmark {
+    int fFrame = 0;
+public:
+    const char* name() const override { return "convex_paths"; }
+    GISize size() const override { return { 512, 512 }; }
+    void draw(GCanvas* canvas) override {
+        const float nudge = (fFrame++ % 100) * 0.01f;
+        GRandom rand;
+        for (int i = 0; i < 150; ++i) {
+            const GPoint center = { rand.nextF() * 512 + nudge, rand.nextF() * 512 };
+            const float r = 4 + rand.nextF() * 60;
+            GPath path;
+            if (i % 3 == 0) {
+                path.addCircle({0, 0}, r);
+            } else if (i % 3 == 1) {
+                path.addRect(GRect::MakeLTRB(-r, -r / 2, r, r / 2));
+            } else {
+                GPoint pts[8];
+                tesselate_circle(pts, 8, 0, 0, r);
+                path.addPolygon(pts, 8);
+            }
+            canvas->save();
+            canvas->translate(center.fX, center.fY);
+            canvas->rotate(rand.nextF() * 6.28f);
+            canvas->drawPath(path, GPaint(rand_color(rand, true)));
+            canvas->restore();
+        }
+    }
+};
+
+// One star that winds around twice, with thousands of edges crossing each row
+class ManyEdgesBench : public GBenchmark {
+    int fFrame = 0;
+public:
+    const char* name() const override { return "many_edges"; }
+    GISize size() const override { return { 512, 512 }; }
+    void draw(GCanvas* canvas) override {
+        const float nudge = (fFrame++ % 100) * 0.01f;
+        const int n = 4001;
+        std::vector<GPoint> pts(n);
+        for (int i = 0; i < n; ++i) {
+            const float angle = i * 4 * 3.14159265f / n;
+            const float r = (i & 1) ? 250 : 20;
+            pts[i] = { 256 + nudge + r * cosf(angle), 256 + r * sinf(angle) };
+        }
+        GPath path;
+        path.addPolygon(pts.data(), n);
+        canvas->drawPath(path, GPaint({1, 0, 0, 1}));
+    }
+};
+
+class CartmanBench : public GBenchmark {
+    const bool fAA;
+public:
+    CartmanBench(bool aa) : fAA(aa) {}
+
+    const char* name() const override { return fAA ? "cartman_aa" : "cartman"; }
+    GISize size() const override { return { 512, 512 }; }
+    void draw(GCanvas* target) override {
+        AntiAliasCanvas aaCanvas(target);
+        GCanvas* canvas = fAA ? &aaCanvas : target;
+        GPath path;
+        GPaint paint;
+        canvas->save();
+#include "cartman.475"
+        canvas->restore();
+    }
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 const GBenchmark::Factory gBenchFactories[] {
@@ -170,5 +549,24 @@ const GBenchmark::Factory gBenchFactories[] {
     []() -> GBenchmark* { return new ModesBench({0.5, 1, 0.5, 0.25}, "modes_half"); },
     []() -> GBenchmark* { return new ModesBench({1.0, 1, 0.5, 0.25}, "modes_1"); },
 
+    []() -> GBenchmark* { return new GradientBench; },
+    []() -> GBenchmark* { return new BitmapTilingBench; },
+    []() -> GBenchmark* { return new ShadedRectsBench; },
+    []() -> GBenchmark* { return new SpritesBench; },
+    []() -> GBenchmark* { return new ShadeWidthBench(256);  },
+    []() -> GBenchmark* { return new ShadeWidthBench(1024); },
+    []() -> GBenchmark* { return new ShadeWidthBench(8192); },
+    []() -> GBenchmark* { return new MeshBench; },
+    []() -> GBenchmark* { return new QuadBench; },
+    []() -> GBenchmark* { return new LionBench(false); },
+    []() -> GBenchmark* { return new LionBench(true); },
+    []() -> GBenchmark* { return new ZoomedLionBench; },
+    []() -> GBenchmark* { return new CurvesBench(false); },
+    []() -> GBenchmark* { return new CurvesBench(true); },
+    []() -> GBenchmark* { return new ConvexPathsBench; },
+    []() -> GBenchmark* { return new ManyEdgesBench; },
+    []() -> GBenchmark* { return new CartmanBench(false); },
+    []() -> GBenchmark* { return new CartmanBench(true); },
+
     nullptr,
 };
@@ -62,10 +62,12 @@ static void setup_bitmap(GBitmap* bitmap, int w, int h) {
     bitmap->reset(w, h, rb, (GPixel*)calloc(h, rb), GBitmap::kNo_IsOpaque);
 }
 
+static int gThreadCount = 1;
+
 static void handle_proc(const GDrawRec& rec, const char path[], GBitmap* bitmap) {
     setup_bitmap(bitmap, rec.fWidth, rec.fHeight);
 
-    auto canvas = GCreateCanvas(*bitmap);
+    auto canvas = GCreateCanvas(*bitmap, gThreadCount);
     if (!canvas) {
         fprintf(stderr, "failed to create canvas for [%d %d] %s\n",
                 rec.fWidth, rec.fHeight, rec.fName);
@@ -74,6 +76,7 @@ static void handle_proc(const GDrawRec& rec, const char path[], GBitmap* bitmap)
 
     canvas->clear({0, 0, 0, 0});
     rec.fDraw(canvas.get());
+    canvas->flush();
 
     if (!bitmap->writeToFile(path)) {
         fprintf(stderr, "failed to write %s\n", path);
@@ -187,6 +190,8 @@ int main(int argc, char** argv) {
             GASSERT(tolerance >= 0);
         } else if (is_arg(argv[i], "scoreFile") && i+1 < argc) {
             scoreFile = argv[++i];
+        } else if (is_arg(argv[i], "threads") && i+1 < argc) {
+            gThreadCount = atoi(argv[++i]);
         } else if (is_arg(argv[i], "diff") && i+1 < argc) {
             diffDir = argv[++i];
             std::string path(diffDir);
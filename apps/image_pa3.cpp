@@ -12,7 +12,7 @@
 #include "GShader.h"
 #include <string>
 
-class CheckerShader : public GShader {
+class CheckerShader : public GLegacyShader {
     const GPixel fP0, fP1;
     const GMatrix fLocalMatrix;
     
@@ -6,9 +6,12 @@
 #define GTestStats_DEFINED
 
 #include "GTypes.h"
+#include <atomic>
 
 extern bool gTestSuite_Verbose;
 extern bool gTestSuite_CrashOnFailure;
+// Heap allocations made so far, see tests_alloc.cpp
+extern std::atomic<int> gTestSuite_NewCount;
 
 struct GTestStats {
     GTestStats() : fTestCounter(0), fPassCounter(0) {}
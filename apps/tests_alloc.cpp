@@ -0,0 +1,62 @@
+/**
+ *  The tests binary's allocator: every heap allocation is counted in gTestSuite_NewCount, so a
+ *  test can check that drawing leaves the heap alone. Each C++11 form of new is replaced along
+ *  with its delete, and they live in their own file so no test inlines one without the other.
+ */
+
+#include "tests.h"
+#include <new>
+#include <stdlib.h>
+
+std::atomic<int> gTestSuite_NewCount(0);
+
+static void* counted_new(size_t size) {
+    gTestSuite_NewCount++;
+    return malloc(size ? size : 1);
+}
+
+void* operator new(size_t size) {
+    if (void* ptr = counted_new(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    if (void* ptr = counted_new(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return counted_new(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return counted_new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    free(ptr);
+}
@@ -0,0 +1,1243 @@
+/**
+ *  Rasterizer regression tests: the fast paths must match the straightforward math.
+ */
+
+#include "GBitmap.h"
+#include "GCanvas.h"
+#include "GRandom.h"
+#include "GShader.h"
+#include "tests.h"
+
+static GPixel rand_premul(GRandom& rand) {
+    unsigned a = rand.nextU() & 0xFF;
+    return GPixel_PackARGB(a, rand.nextU() % (a + 1), rand.nextU() % (a + 1),
+                           rand.nextU() % (a + 1));
+}
+
+// Reference blend, written straight from the GBlendMode formulas with div255 rounding
+static unsigned ref_div255(unsigned x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static GPixel ref_scale(GPixel p, unsigned s) {
+    return GPixel_PackARGB(ref_div255(GPixel_GetA(p) * s), ref_div255(GPixel_GetR(p) * s),
+                           ref_div255(GPixel_GetG(p) * s), ref_div255(GPixel_GetB(p) * s));
+}
+
+static GPixel ref_blend(GBlendMode mode, GPixel s, GPixel d) {
+    const unsigned sa = GPixel_GetA(s), da = GPixel_GetA(d);
+    switch (mode) {
+        case GBlendMode::kClear:   return 0;
+        case GBlendMode::kSrc:     return s;
+        case GBlendMode::kDst:     return d;
+        case GBlendMode::kSrcOver: return s + ref_scale(d, 255 - sa);
+        case GBlendMode::kDstOver: return d + ref_scale(s, 255 - da);
+        case GBlendMode::kSrcIn:   return ref_scale(s, da);
+        case GBlendMode::kDstIn:   return ref_scale(d, sa);
+        case GBlendMode::kSrcOut:  return ref_scale(s, 255 - da);
+        case GBlendMode::kDstOut:  return ref_scale(d, 255 - sa);
+        case GBlendMode::kSrcATop: return ref_scale(s, da) + ref_scale(d, 255 - sa);
+        case GBlendMode::kDstATop: return ref_scale(s, 255 - da) + ref_scale(d, sa);
+        case GBlendMode::kXor:     return ref_scale(s, 255 - da) + ref_scale(d, 255 - sa);
+    }
+    return 0;
+}
+
+// Every blend mode, over a row wide enough to hit the vector loops and their scalar tails
+static void test_blend_rows(GTestStats* stats) {
+    const int W = 37;
+    GRandom rand;
+
+    GBitmap src, dst, orig;
+    setup_bitmap(&src, W, 1);
+    setup_bitmap(&dst, W, 1);
+    setup_bitmap(&orig, W, 1);
+    for (int x = 0; x < W; ++x) {
+        *src.getAddr(x, 0) = rand_premul(rand);
+        *orig.getAddr(x, 0) = rand_premul(rand);
+    }
+    // An opaque copy of src, flagged as such so the canvas may take its opaque-only shortcuts
+    GPixel* opaquePixels = (GPixel*)calloc(W, sizeof(GPixel));
+    for (int x = 0; x < W; ++x) {
+        opaquePixels[x] = *src.getAddr(x, 0) | GPixel_PackARGB(0xFF, 0, 0, 0);
+    }
+    GBitmap opaque;
+    opaque.reset(W, 1, W * sizeof(GPixel), opaquePixels, GBitmap::kCompute_IsOpaque);
+    auto canvas = GCreateCanvas(dst);
+    std::unique_ptr<GShader> shaders[] = {
+        GCreateBitmapShader(src, GMatrix()), GCreateBitmapShader(opaque, GMatrix()),
+    };
+    const GBitmap* shaderSrc[] = { &src, &opaque };
+
+    const GColor colors[] = {
+        { 0, 1, 0.5f, 0.25f }, { 0.5f, 1, 0.5f, 0.25f }, { 1, 1, 0.5f, 0.25f },
+    };
+    for (int m = 0; m < 12; ++m) {
+        const GBlendMode mode = static_cast<GBlendMode>(m);
+        bool ok = true;
+        for (const GColor& c : colors) {
+            memcpy(dst.pixels(), orig.pixels(), W * sizeof(GPixel));
+            GPaint paint(c);
+            canvas->drawPaint(paint.setBlendMode(mode));
+
+            const float a = GPinToUnit(c.fA);
+            const GPixel s = GPixel_PackARGB(GRoundToInt(a * 255), GRoundToInt(a * c.fR * 255),
+                                             GRoundToInt(a * c.fG * 255),
+                                             GRoundToInt(a * c.fB * 255));
+            for (int x = 0; x < W; ++x) {
+                ok &= *dst.getAddr(x, 0) == ref_blend(mode, s, *orig.getAddr(x, 0));
+            }
+        }
+        stats->expectTrue(ok, "blend_row_color");
+
+        for (int i = 0; i < 2; ++i) {
+            memcpy(dst.pixels(), orig.pixels(), W * sizeof(GPixel));
+            GPaint paint(shaders[i].get());
+            canvas->drawPaint(paint.setBlendMode(mode));
+            ok = true;
+            for (int x = 0; x < W; ++x) {
+                ok &= *dst.getAddr(x, 0) == ref_blend(mode, *shaderSrc[i]->getAddr(x, 0),
+                                                      *orig.getAddr(x, 0));
+            }
+            stats->expectTrue(ok, "blend_row_shader");
+        }
+    }
+
+    free(opaque.pixels());
+    free(src.pixels());
+    free(dst.pixels());
+    free(orig.pixels());
+}
+
+static void draw_tiled_scene(GCanvas* canvas) {
+    GRandom rand;
+    canvas->clear({1, 1, 1, 1});
+    const GColor gradColors[] = { {1, 1, 0, 0}, {0.5f, 0, 1, 0}, {1, 0, 0, 1} };
+    auto gradient = GCreateLinearGradient({0, 0}, {60, 40}, gradColors, 3, GShader::kMirror);
+    for (int i = 0; i < 40; ++i) {
+        GColor c = { rand.nextF(), rand.nextF(), rand.nextF(), rand.nextF() };
+        GPaint paint(c);
+        paint.setBlendMode(static_cast<GBlendMode>(rand.nextRange(0, 11)));
+        paint.setAntiAlias(i % 5 < 2);
+
+        canvas->save();
+        canvas->translate(rand.nextF() * 200, rand.nextF() * 200);
+        canvas->rotate(rand.nextF() * 6);
+        if (i % 3 == 2) {
+            paint.setShader(gradient.get());
+        }
+        switch (i % 4) {
+            case 0:
+                canvas->drawRect(GRect::MakeXYWH(-20, -30, 90, 70), paint);
+                break;
+            case 1: {
+                GPoint pts[] = { {0, -50}, {40, 20}, {-10, 60}, {-45, 10} };
+                canvas->drawConvexPolygon(pts, 4, paint);
+            } break;
+            case 2: {
+                GPath path;
+                path.moveTo(0, 0).lineTo(80, 10).quadTo({100, 90}, {20, 70})
+                    .cubicTo({-30, 50}, {60, -40}, {-20, -60});
+                path.addRect(GRect::MakeXYWH(10, 10, 30, 30), GPath::kCCW_Direction);
+                canvas->drawPath(path, paint);
+            } break;
+            case 3: {
+                GPoint verts[] = { {0, 0}, {70, 5}, {60, 60}, {-5, 50} };
+                GColor colors[] = { c, {1, 0, 0, 1}, {1, 0, 1, 0}, {0.5f, 0, 0, 1} };
+                GPoint texs[] = { {0, 0}, {60, 0}, {60, 40}, {0, 40} };
+                canvas->drawQuad(verts, colors, paint.getShader() ? texs : nullptr, 3, paint);
+            } break;
+        }
+        canvas->restore();
+    }
+}
+
+// Only implements the setContext()/shadeRow() pair, like shaders written before contexts
+class LegacyStripeShader : public GLegacyShader {
+    GMatrix fInverse;
+public:
+    bool isOpaque() override { return true; }
+
+    bool setContext(const GMatrix& ctm) override {
+        return ctm.invert(&fInverse);
+    }
+
+    void shadeRow(int x, int y, int count, GPixel row[]) override {
+        for (int i = 0; i < count; ++i) {
+            GPoint p = fInverse.mapXY(x + i + 0.5f, y + 0.5f);
+            row[i] = ((int)floorf(p.fX / 7) & 1) ? GPixel_PackARGB(0xFF, 0xFF, 0, 0)
+                                                : GPixel_PackARGB(0xFF, 0, 0, 0xFF);
+        }
+    }
+};
+
+// Contexts made for different CTMs must not disturb each other (or the shader), whichever way
+// the shader is implemented.
+static void test_shader_contexts(GTestStats* stats) {
+    const int N = 29;
+    const GColor colors[] = { {1, 1, 0, 0}, {0.25f, 0, 1, 0}, {1, 0, 0, 1} };
+    auto gradient = GCreateLinearGradient({3, 5}, {40, 20}, colors, 3, GShader::kRepeat);
+    LegacyStripeShader legacy;
+    GShader* shaders[] = { gradient.get(), &legacy };
+    const GMatrix ctmA = GMatrix::MakeScale(2, 3);
+    const GMatrix ctmB = GMatrix::MakeTranslate(-7, 11);
+
+    for (GShader* shader : shaders) {
+        // Each context on its own...
+        GPixel expectA[N], expectB[N], rowA[N], rowB[N];
+        {
+            GArena solo;
+            GShader::Context* a = shader->makeContext(ctmA, &solo);
+            a->shadeRow(4, 9, N, expectA);
+            GShader::Context* b = shader->makeContext(ctmB, &solo);
+            b->shadeRow(4, 9, N, expectB);
+        }
+
+        // ...and both at once, used in the other order
+        GArena arena;
+        GShader::Context* a = shader->makeContext(ctmA, &arena);
+        GShader::Context* b = shader->makeContext(ctmB, &arena);
+        bool ok = a && b;
+        if (ok) {
+            b->shadeRow(4, 9, N, rowB);
+            a->shadeRow(4, 9, N, rowA);
+            ok = !memcmp(rowA, expectA, sizeof(rowA)) && !memcmp(rowB, expectB, sizeof(rowB));
+        }
+        stats->expectTrue(ok, "shader_contexts");
+    }
+
+    // A legacy shader's contexts shade what its own setContext() and shadeRow() do
+    GPixel expect[N], row[N];
+    legacy.setContext(ctmA);
+    legacy.shadeRow(4, 9, N, expect);
+    GArena arena;
+    GShader::Context* context = legacy.makeContext(ctmA, &arena);
+    context->shadeRow(4, 9, N, row);
+    stats->expectTrue(!memcmp(row, expect, sizeof(row)), "shader_contexts_legacy");
+
+    stats->expectTrue(!gradient->makeContext(GMatrix(0, 0, 0, 0, 0, 0), &arena),
+                      "shader_contexts_singular");
+}
+
+// A row must shade the same in one call as split into calls of any width, so blits don't
+// depend on how many pixels they shade at a time
+static void test_shader_split_rows(GTestStats* stats) {
+    const int N = 300;
+    const GColor colors[] = { {1, 1, 0, 0}, {0.5f, 0, 1, 0}, {1, 0, 0, 1} };
+    GBitmap bm;
+    setup_bitmap(&bm, 5, 7);
+    for (int y = 0; y < 7; ++y) {
+        for (int x = 0; x < 5; ++x) {
+            *bm.getAddr(x, y) = GPixel_PackARGB(0xFF, x * 50, y * 30, 0);
+        }
+    }
+    const GShader::TileMode modes[] = { GShader::kClamp, GShader::kRepeat, GShader::kMirror };
+    const GMatrix ctms[] = {
+        GMatrix(),
+        GMatrix(0.37f, -0.81f, 13.3f, 0.92f, 0.41f, -7.7f),
+    };
+    const int splits[] = { 1, 7, 64, 100 };
+    for (GShader::TileMode mode : modes) {
+        auto gradient = GCreateLinearGradient({3.3f, 1.7f}, {41.9f, 20.2f}, colors, 3, mode);
+        auto bitmap = GCreateBitmapShader(bm, GMatrix(1.7f, 0.3f, 2.2f, -0.4f, 2.1f, 5.9f), mode);
+        GShader* shaders[] = { gradient.get(), bitmap.get() };
+        for (GShader* shader : shaders) {
+            for (const GMatrix& ctm : ctms) {
+                GArena arena;
+                GShader::Context* context = shader->makeContext(ctm, &arena);
+                bool ok = true;
+                for (int y = -40; y < 40; y += 9) {
+                    GPixel whole[N], split[N];
+                    context->shadeRow(-120, y, N, whole);
+                    for (int i = 0, s = 0; i < N; ++s) {
+                        int n = std::min(N - i, splits[s % 4]);
+                        context->shadeRow(-120 + i, y, n, split + i);
+                        i += n;
+                    }
+                    ok &= !memcmp(whole, split, sizeof(whole));
+                }
+                stats->expectTrue(ok, "shader_split_rows");
+            }
+        }
+    }
+    free(bm.pixels());
+}
+
+static float ref_tile(float t, GShader::TileMode mode) {
+    switch (mode) {
+        case GShader::kClamp:  return std::max(0.0f, std::min(t, 1.0f));
+        case GShader::kRepeat: return t - floorf(t);
+        case GShader::kMirror: {
+            float u = t * 0.5f - floorf(t * 0.5f);
+            return (u > 0.5f ? 1 - u : u) * 2;
+        }
+    }
+    return t;
+}
+
+static bool close_pixels(GPixel a, GPixel b, int tolerance) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        if (abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF)) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The baked gradient table must stay within a couple of units of the exact per-pixel lerp,
+// in every tile mode and well outside [p0, p1]
+static void test_gradient_table(GTestStats* stats) {
+    const int N = 300;
+    const GColor c0 = { 1, 1, 0, 0 }, c1 = { 0.5f, 0, 0, 1 };
+    const GShader::TileMode modes[] = { GShader::kClamp, GShader::kRepeat, GShader::kMirror };
+    for (GShader::TileMode mode : modes) {
+        auto shader = GCreateLinearGradient({20, 0}, {90, 0}, c0, c1, mode);
+        GArena arena;
+        GShader::Context* context = shader->makeContext(GMatrix(), &arena);
+        GPixel row[N];
+        context->shadeRow(-50, 7, N, row);
+
+        bool ok = true;
+        for (int i = 0; i < N; ++i) {
+            float t = ref_tile((-50 + i + 0.5f - 20) / 70, mode);
+            float a = c0.fA + (c1.fA - c0.fA) * t;
+            GPixel expected = GPixel_PackARGB(GRoundToInt(a * 255),
+                                              GRoundToInt(a * (c0.fR + (c1.fR - c0.fR) * t) * 255),
+                                              0,
+                                              GRoundToInt(a * (c0.fB + (c1.fB - c0.fB) * t) * 255));
+            ok &= close_pixels(row[i], expected, 2);
+        }
+        stats->expectTrue(ok, "gradient_table");
+    }
+}
+
+// Pixel centers a hair below or above a whole period (t = k -+ 1.25e-6) must land on the
+// matching side of the seam in repeat and mirror
+static void test_gradient_seams(GTestStats* stats) {
+    const GColor c0 = { 1, 1, 0, 0 }, c1 = { 1, 0, 0, 1 };
+    const GPixel p0 = GPixel_PackARGB(0xFF, 0xFF, 0, 0), p1 = GPixel_PackARGB(0xFF, 0, 0, 0xFF);
+    const float offsets[] = { 1e-5f, -1e-5f };
+    const GShader::TileMode modes[] = { GShader::kRepeat, GShader::kMirror };
+    for (float e : offsets) {
+        for (GShader::TileMode mode : modes) {
+            // Pixel 8k has its center at t = k - e/8
+            auto shader = GCreateLinearGradient({0.5f + e, 0}, {8.5f + e, 0}, c0, c1, mode);
+            GArena arena;
+            GShader::Context* context = shader->makeContext(GMatrix(), &arena);
+            GPixel row[41];
+            context->shadeRow(-16, 3, 41, row);
+
+            bool ok = true;
+            for (int k = -2; k <= 3; ++k) {
+                bool odd = k & 1;
+                GPixel expected = mode == GShader::kRepeat ? (e > 0 ? p1 : p0) : (odd ? p1 : p0);
+                ok &= row[8 * k + 16] == expected;
+            }
+            stats->expectTrue(ok, "gradient_seams");
+        }
+    }
+}
+
+static int ref_tile_texel(int q, int size, GShader::TileMode mode) {
+    switch (mode) {
+        case GShader::kClamp:  return std::max(0, std::min(q, size - 1));
+        case GShader::kRepeat: return ((q % size) + size) % size;
+        case GShader::kMirror: {
+            int r = ((q % (2 * size)) + 2 * size) % (2 * size);
+            return r < size ? r : 2 * size - 1 - r;
+        }
+    }
+    return q;
+}
+
+// Nearest-neighbor bitmap sampling, for power-of-2 and other sizes, against texel math done
+// in double per pixel
+static void test_bitmap_sampling(GTestStats* stats) {
+    const GISize sizes[] = { {4, 8}, {3, 5} };
+    const GShader::TileMode modes[] = { GShader::kClamp, GShader::kRepeat, GShader::kMirror };
+    const GMatrix locals[] = {
+        GMatrix(2.5f, 0, -13.3f, 0, 2.5f, 7.1f),
+        GMatrix(1.7f, -0.6f, 5.23f, 0.8f, 1.3f, -9.41f),
+        GMatrix::MakeTranslate(-13.3f, 7.6f),
+    };
+    const int N = 61;
+    for (GISize size : sizes) {
+        GBitmap bm;
+        setup_bitmap(&bm, size.width(), size.height());
+        for (int y = 0; y < size.height(); ++y) {
+            for (int x = 0; x < size.width(); ++x) {
+                *bm.getAddr(x, y) = GPixel_PackARGB(0xFF, x * 16, y * 16, 0);
+            }
+        }
+        for (GShader::TileMode mode : modes) {
+            for (const GMatrix& local : locals) {
+                auto shader = GCreateBitmapShader(bm, local, mode);
+                GMatrix inverse;
+                local.invert(&inverse);
+                GArena arena;
+                GShader::Context* context = shader->makeContext(GMatrix(), &arena);
+                bool ok = true;
+                for (int y = -20; y < 20; y += 7) {
+                    GPixel row[N];
+                    context->shadeRow(-30, y, N, row);
+                    for (int i = 0; i < N; ++i) {
+                        double dx = -30 + i + 0.5, dy = y + 0.5;
+                        double u = inverse[0] * dx + inverse[1] * dy + inverse[2];
+                        double v = inverse[3] * dx + inverse[4] * dy + inverse[5];
+                        int tx = ref_tile_texel((int)floor(u), size.width(), mode);
+                        int ty = ref_tile_texel((int)floor(v), size.height(), mode);
+                        ok &= row[i] == *bm.getAddr(tx, ty);
+                    }
+                }
+                stats->expectTrue(ok, "bitmap_sampling");
+            }
+        }
+        free(bm.pixels());
+    }
+}
+
+// Triangles that share edges must cover every pixel exactly once: a translucent mesh over a
+// jittered grid blends each covered pixel one time, with no seams and no double blends.
+static void test_mesh_coverage(GTestStats* stats) {
+    const int W = 120, H = 120, N = 8;
+    GBitmap bm;
+    setup_bitmap(&bm, W, H);
+    auto canvas = GCreateCanvas(bm);
+    canvas->clear({1, 1, 1, 1});
+
+    GRandom rand;
+    GPoint verts[(N + 1) * (N + 1)];
+    GColor colors[(N + 1) * (N + 1)];
+    for (int j = 0; j <= N; ++j) {
+        for (int i = 0; i <= N; ++i) {
+            float x = 10 + i * 12.5f, y = 10 + j * 12.5f;
+            if (i > 0 && i < N && j > 0 && j < N) {
+                x += rand.nextF() * 8 - 4;
+                y += rand.nextF() * 8 - 4;
+            }
+            verts[j * (N + 1) + i] = { x, y };
+            colors[j * (N + 1) + i] = { 0.5f, 1, 0, 0 };
+        }
+    }
+    int indices[N * N * 6];
+    int* idx = indices;
+    for (int j = 0; j < N; ++j) {
+        for (int i = 0; i < N; ++i) {
+            int v = j * (N + 1) + i;
+            *idx++ = v;  *idx++ = v + 1;      *idx++ = v + N + 2;
+            *idx++ = v;  *idx++ = v + N + 2;  *idx++ = v + N + 1;
+        }
+    }
+    canvas->drawMesh(verts, colors, nullptr, N * N * 2, indices, GPaint());
+    // An empty mesh draws nothing, and reads no indices
+    canvas->drawMesh(verts, colors, nullptr, 0, indices, GPaint());
+
+    const GPixel once = *bm.getAddr(60, 60);
+    bool ok = GPixel_GetA(once) == 0xFF && GPixel_GetG(once) < 0xFF;
+    for (int y = 11; y < 109; ++y) {
+        for (int x = 11; x < 109; ++x) {
+            ok &= *bm.getAddr(x, y) == once;
+        }
+    }
+    stats->expectTrue(ok, "mesh_coverage");
+
+    // A triangle off the right edge stops where the same polygon does, short of the last column
+    const GPoint tri[] = { {W - 20.0f, 10}, {W + 50.0f, 10}, {W - 20.0f, 80} };
+    const GColor red[] = { {1, 1, 0, 0}, {1, 1, 0, 0}, {1, 1, 0, 0} };
+    const int triIndices[] = { 0, 1, 2 };
+    GPaint redPaint({1, 1, 0, 0});
+    for (int pass = 0; pass < 2; ++pass) {
+        canvas->clear({1, 1, 1, 1});
+        if (pass == 0) {
+            canvas->drawMesh(tri, red, nullptr, 1, triIndices, GPaint());
+        } else {
+            canvas->drawConvexPolygon(tri, 3, redPaint);
+        }
+        bool edge = true;
+        for (int y = 20; y < 50; ++y) {
+            edge &= *bm.getAddr(W - 2, y) == GPixel_PackARGB(0xFF, 0xFF, 0, 0);
+            edge &= *bm.getAddr(W - 1, y) == GPixel_PackARGB(0xFF, 0xFF, 0xFF, 0xFF);
+        }
+        stats->expectTrue(edge, "mesh_coverage_right_edge");
+    }
+    free(bm.pixels());
+}
+
+// Every tessellation level must tile the quad exactly: no dropped or duplicated rows of cells
+static void test_quad_levels(GTestStats* stats) {
+    const int W = 100, H = 100;
+    GBitmap bm;
+    setup_bitmap(&bm, W, H);
+    auto canvas = GCreateCanvas(bm);
+    const GPoint verts[] = { {10, 10}, {90, 10}, {90, 90}, {10, 90} };
+    const GColor colors[] = { {0.6f, 0, 0, 1}, {0.6f, 0, 0, 1}, {0.6f, 0, 0, 1}, {0.6f, 0, 0, 1} };
+    for (int level = 0; level <= 12; ++level) {
+        canvas->clear({1, 1, 1, 1});
+        canvas->drawQuad(verts, colors, nullptr, level, GPaint());
+        const GPixel once = *bm.getAddr(50, 50);
+        bool ok = GPixel_GetR(once) < 0xFF;
+        for (int y = 10; y < 90; ++y) {
+            for (int x = 10; x < 90; ++x) {
+                ok &= *bm.getAddr(x, y) == once;
+            }
+        }
+        // and nothing spills past the last row or column of cells
+        for (int i = 0; i < 100; ++i) {
+            ok &= *bm.getAddr(i, 95) == 0xFFFFFFFF && *bm.getAddr(95, i) == 0xFFFFFFFF;
+        }
+        stats->expectTrue(ok, "quad_levels");
+    }
+    free(bm.pixels());
+}
+
+// The tiled multithreaded canvas must produce exactly the pixels of the plain canvas
+static void test_tiled_canvas(GTestStats* stats) {
+    const int W = 250, H = 230;
+    GBitmap single, tiled;
+    setup_bitmap(&single, W, H);
+    setup_bitmap(&tiled, W, H);
+
+    draw_tiled_scene(GCreateCanvas(single).get());
+    {
+        auto canvas = GCreateCanvas(tiled, 4);
+        draw_tiled_scene(canvas.get());
+        canvas->flush();
+        stats->expectTrue(!memcmp(single.pixels(), tiled.pixels(), H * single.rowBytes()),
+                          "tiled_canvas_flush");
+
+        // Drawing after a flush keeps recording on the same canvas
+        canvas->drawRect(GRect::MakeXYWH(10, 10, 100, 100), GPaint({0.5f, 0, 1, 0}));
+    }
+    GCreateCanvas(single)->drawRect(GRect::MakeXYWH(10, 10, 100, 100), GPaint({0.5f, 0, 1, 0}));
+    stats->expectTrue(!memcmp(single.pixels(), tiled.pixels(), H * single.rowBytes()),
+                      "tiled_canvas_destroy");
+
+    free(single.pixels());
+    free(tiled.pixels());
+}
+
+// Once a canvas has drawn a frame, drawing it again must not touch the heap: edges, mapped
+// points, row buffers and shader contexts all come from the canvas' scratch arena.
+static void test_steady_state_allocs(GTestStats* stats) {
+    const int W = 200, H = 200;
+    GBitmap bm, tex;
+    setup_bitmap(&bm, W, H);
+    setup_bitmap(&tex, 16, 16);
+    GRandom rand;
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 16; ++x) {
+            *tex.getAddr(x, y) = rand_premul(rand);
+        }
+    }
+    const GColor gradColors[] = { {1, 1, 0, 0}, {0.5f, 0, 1, 0}, {1, 0, 0, 1} };
+    auto gradient = GCreateLinearGradient({0, 0}, {60, 40}, gradColors, 3, GShader::kMirror);
+    auto bitmap = GCreateBitmapShader(tex, GMatrix::MakeScale(3, 2), GShader::kRepeat);
+    GPath path;
+    path.moveTo(0, 0).lineTo(80, 10).quadTo({100, 90}, {20, 70})
+        .cubicTo({-30, 50}, {60, -40}, {-20, -60});
+    path.addRect(GRect::MakeXYWH(10, 10, 30, 30), GPath::kCCW_Direction);
+    const GPoint poly[] = { {0, -50}, {40, 20}, {-10, 60}, {-45, 10} };
+    const GPoint verts[] = { {0, 0}, {70, 5}, {60, 60}, {-5, 50} };
+    const GColor colors[] = { {1, 0, 1, 0}, {1, 0, 0, 1}, {0.5f, 1, 0, 0}, {1, 1, 1, 0} };
+    const GPoint texs[] = { {0, 0}, {60, 0}, {60, 40}, {0, 40} };
+    GShader* shaders[] = { nullptr, gradient.get(), bitmap.get() };
+
+    auto canvas = GCreateCanvas(bm);
+    int firstNews = 0, frameNews = 0;
+    for (int frame = 0; frame < 3; ++frame) {
+        const int before = gTestSuite_NewCount;
+        canvas->clear({1, 1, 1, 1});
+        for (int i = 0; i < 12; ++i) {
+            GPaint paint({0.7f, 0.2f, 0.4f, 0.9f});
+            paint.setShader(shaders[i % 3]);
+            paint.setBlendMode(i & 4 ? GBlendMode::kSrcOver : GBlendMode::kDstATop);
+            paint.setAntiAlias(i & 1);
+            canvas->save();
+            canvas->translate(20 + i * 13, 30 + i * 11);
+            canvas->rotate(i * 0.5f);
+            canvas->drawRect(GRect::MakeXYWH(-20, -30, 90, 70), paint);
+            canvas->drawConvexPolygon(poly, 4, paint);
+            canvas->drawPath(path, paint);
+            canvas->drawQuad(verts, colors, texs, i % 4, paint);
+            canvas->restore();
+        }
+        frameNews = gTestSuite_NewCount - before;
+        // The first frame grows the arena, which shows the allocations are being counted
+        firstNews = frame == 0 ? frameNews : firstNews;
+    }
+    stats->expectTrue(firstNews > 0 && frameNews == 0, "steady_state_allocs");
+    free(bm.pixels());
+    free(tex.pixels());
+}
+
+// Red component of the pixel black leaves on white, at coverage c
+static bool near_coverage(GPixel p, float c) {
+    int expected = GRoundToInt(255 * (1 - c));
+    return abs((int)GPixel_GetR(p) - expected) <= 1 && GPixel_GetA(p) == 0xFF;
+}
+
+// Anti-aliased fills cover each pixel by the exact area inside them, and overlapping contours
+// follow the non-zero winding rule
+static void test_antialias(GTestStats* stats) {
+    const int W = 100, H = 100;
+    GBitmap aliased, aa;
+    setup_bitmap(&aliased, W, H);
+    setup_bitmap(&aa, W, H);
+    auto aliasedCanvas = GCreateCanvas(aliased);
+    auto aaCanvas = GCreateCanvas(aa);
+
+    // On pixel bounds, coverage is all or nothing: same pixels as the aliased fill
+    GPaint paint({0.6f, 0.2f, 0.8f, 0.4f});
+    aliasedCanvas->clear({1, 1, 1, 1});
+    aaCanvas->clear({1, 1, 1, 1});
+    aliasedCanvas->drawRect(GRect::MakeLTRB(10, 12, 60, 47), paint);
+    aaCanvas->drawRect(GRect::MakeLTRB(10, 12, 60, 47), GPaint(paint).setAntiAlias(true));
+    stats->expectTrue(!memcmp(aliased.pixels(), aa.pixels(), H * aa.rowBytes()), "aa_pixel_rect");
+
+    // Fractional edges cover the fraction of the pixel inside them
+    GPaint black({1, 0, 0, 0});
+    black.setAntiAlias(true);
+    aaCanvas->clear({1, 1, 1, 1});
+    aaCanvas->drawRect(GRect::MakeLTRB(10.25f, 5.5f, 30.75f, 20), black);
+    bool ok = near_coverage(*aa.getAddr(10, 10), 0.75f) && near_coverage(*aa.getAddr(30, 10), 0.75f)
+           && near_coverage(*aa.getAddr(20, 5), 0.5f) && near_coverage(*aa.getAddr(10, 5), 0.375f)
+           && near_coverage(*aa.getAddr(20, 10), 1) && near_coverage(*aa.getAddr(20, 20), 0);
+    stats->expectTrue(ok, "aa_fractional_rect");
+
+    // A diagonal through pixel corners halves each pixel it crosses
+    aaCanvas->clear({1, 1, 1, 1});
+    const GPoint tri[] = { {0, 0}, {100, 0}, {0, 100} };
+    aaCanvas->drawConvexPolygon(tri, 3, black);
+    ok = true;
+    for (int i = 0; i < W; ++i) {
+        ok &= near_coverage(*aa.getAddr(i, 99 - i), 0.5f);
+        ok &= i == 0 || near_coverage(*aa.getAddr(i - 1, 99 - i), 1);
+    }
+    stats->expectTrue(ok, "aa_diagonal");
+
+    // Overlapping contours in the same direction don't add up; one the other way cuts a hole
+    aaCanvas->clear({1, 1, 1, 1});
+    GPath path;
+    path.addRect(GRect::MakeLTRB(10.5f, 10.5f, 70.5f, 70.5f));
+    path.addRect(GRect::MakeLTRB(40.5f, 40.5f, 90.5f, 90.5f));
+    path.addRect(GRect::MakeLTRB(20.5f, 20.5f, 30.5f, 30.5f), GPath::kCCW_Direction);
+    GPaint halfBlack({1, 0, 0, 0});
+    halfBlack.setAntiAlias(true);
+    aaCanvas->drawPath(path, halfBlack);
+    ok = near_coverage(*aa.getAddr(50, 50), 1) && near_coverage(*aa.getAddr(25, 25), 0)
+      && near_coverage(*aa.getAddr(70, 30), 0.5f) && near_coverage(*aa.getAddr(20, 25), 0.5f)
+      && near_coverage(*aa.getAddr(60, 90), 0.5f) && near_coverage(*aa.getAddr(80, 20), 0);
+    stats->expectTrue(ok, "aa_nonzero");
+
+    free(aliased.pixels());
+    free(aa.pixels());
+}
+
+// A path gets a mask the second time it misses, and drawing it again under the same CTM reuses
+// that mask, with the same pixels; any other CTM (even a translation) misses. The first miss
+// draws the path directly and adds nothing to the cache.
+static void test_path_mask_cache(GTestStats* stats) {
+    const int W = 120, H = 120;
+    GBitmap first, again;
+    setup_bitmap(&first, W, H);
+    setup_bitmap(&again, W, H);
+    GPath path;
+    path.moveTo(10, 10).quadTo({110, 20}, {90, 100}).cubicTo({40, 130}, {0, 60}, {50, 50});
+    path.addCircle({60, 60}, 20, GPath::kCCW_Direction);
+
+    bool ok = true;
+    for (int aa = 0; aa < 2; ++aa) {
+        GPaint paint({0.8f, 0.1f, 0.5f, 0.9f});
+        paint.setAntiAlias(aa);
+        auto firstCanvas = GCreateCanvas(first);
+        auto againCanvas = GCreateCanvas(again);
+        firstCanvas->clear({1, 1, 1, 1});
+        againCanvas->clear({1, 1, 1, 1});
+        firstCanvas->drawPath(path, paint);
+
+        const GPathMaskCacheStats start = GGetPathMaskCacheStats();
+        againCanvas->drawPath(path, paint);
+        ok &= GGetPathMaskCacheStats().fBytes == start.fBytes;
+        ok &= !memcmp(first.pixels(), again.pixels(), H * first.rowBytes());
+        againCanvas->clear({1, 1, 1, 1});
+        againCanvas->drawPath(path, paint);
+        const GPathMaskCacheStats before = GGetPathMaskCacheStats();
+        ok &= before.fBytes > start.fBytes;
+        ok &= !memcmp(first.pixels(), again.pixels(), H * first.rowBytes());
+        againCanvas->clear({1, 1, 1, 1});
+        againCanvas->drawPath(path, paint);
+        const GPathMaskCacheStats hit = GGetPathMaskCacheStats();
+        ok &= hit.fHits == before.fHits + 1 && hit.fMisses == before.fMisses;
+        ok &= !memcmp(first.pixels(), again.pixels(), H * first.rowBytes());
+
+        againCanvas->translate(0.5f, 0);
+        againCanvas->drawPath(path, paint);
+        ok &= GGetPathMaskCacheStats().fMisses == hit.fMisses + 1;
+
+        // A tiled canvas's bands each cache their own rows, through a miss, a new mask and hits
+        auto tiledCanvas = GCreateCanvas(again, 4);
+        for (int frame = 0; frame < 4; ++frame) {
+            tiledCanvas->clear({1, 1, 1, 1});
+            tiledCanvas->drawPath(path, paint);
+            tiledCanvas->flush();
+            ok &= !memcmp(first.pixels(), again.pixels(), H * first.rowBytes());
+        }
+    }
+    stats->expectTrue(ok, "path_mask_cache");
+
+    free(first.pixels());
+    free(again.pixels());
+}
+
+// The type mask says what a matrix does, and mapping points with it, however its loops are
+// specialized, gives exactly the full SX*x + KX*y + TX per point
+static void test_matrix_types(GTestStats* stats) {
+    GMatrix rotate = GMatrix::MakeRotate(0.3f);
+    rotate.postTranslate(3.5f, -2);
+    const GMatrix matrices[] = {
+        GMatrix(), GMatrix::MakeTranslate(3.25f, -7), GMatrix::MakeScale(2, -0.5f),
+        GMatrix(1.5f, 0, -4, 0, 3, 9.75f), rotate, GMatrix(1, 0.25f, 0, 0, 1, 0),
+    };
+    const unsigned types[] = {
+        GMatrix::kIdentity_Mask, GMatrix::kTranslate_Mask, GMatrix::kScale_Mask,
+        GMatrix::kScale_Mask | GMatrix::kTranslate_Mask,
+        GMatrix::kScale_Mask | GMatrix::kTranslate_Mask | GMatrix::kAffine_Mask,
+        GMatrix::kAffine_Mask,
+    };
+    GRandom rand;
+    GPoint src[13], dst[13];
+    for (GPoint& p : src) {
+        p = { rand.nextF() * 400 - 200, rand.nextF() * 400 - 200 };
+    }
+    bool ok = true;
+    for (int m = 0; m < 6; ++m) {
+        const GMatrix& matrix = matrices[m];
+        ok &= matrix.getType() == types[m];
+        matrix.mapPoints(dst, src, 13);
+        for (int i = 0; i < 13; ++i) {
+            float x = matrix[0] * src[i].fX + matrix[1] * src[i].fY + matrix[2];
+            float y = matrix[3] * src[i].fX + matrix[4] * src[i].fY + matrix[5];
+            ok &= dst[i].fX == x && dst[i].fY == y;
+        }
+    }
+    ok &= matrices[1].isTranslate() && !matrices[2].isTranslate();
+    ok &= matrices[3].isScaleTranslate() && !matrices[4].isScaleTranslate();
+    stats->expectTrue(ok, "matrix_types");
+}
+
+// drawRect's axis-aligned path must draw exactly what drawConvexPolygon draws for the same four
+// corners: rects partly or fully off the device, flipped by the CTM, solid and shaded
+static void test_axis_aligned_rect(GTestStats* stats) {
+    const int W = 90, H = 70;
+    GBitmap rectBm, polyBm;
+    setup_bitmap(&rectBm, W, H);
+    setup_bitmap(&polyBm, W, H);
+    const GColor gradColors[] = { {0.8f, 1, 0, 0}, {0.4f, 0, 0, 1} };
+    auto horizontal = GCreateLinearGradient({5, 0}, {60, 0}, gradColors, 2, GShader::kMirror);
+    auto diagonal = GCreateLinearGradient({0, 0}, {30, 40}, gradColors, 2, GShader::kRepeat);
+    GShader* shaders[] = { nullptr, horizontal.get(), diagonal.get() };
+    const GMatrix matrices[] = {
+        GMatrix(), GMatrix::MakeTranslate(10.5f, -3.25f), GMatrix(1.5f, 0, 4.7f, 0, 0.75f, 8.2f),
+        GMatrix(-1.25f, 0, 95.3f, 0, -2, 80.6f),
+    };
+    GRandom rand;
+    bool ok = true;
+    for (int m = 0; m < 4; ++m) {
+        auto rectCanvas = GCreateCanvas(rectBm);
+        auto polyCanvas = GCreateCanvas(polyBm);
+        rectCanvas->clear({1, 1, 1, 1});
+        polyCanvas->clear({1, 1, 1, 1});
+        rectCanvas->concat(matrices[m]);
+        polyCanvas->concat(matrices[m]);
+        for (int i = 0; i < 60; ++i) {
+            GRect r = GRect::MakeXYWH(rand.nextF() * 140 - 30, rand.nextF() * 120 - 30,
+                                      rand.nextF() * 60, rand.nextF() * 50);
+            GPaint paint({0.6f, rand.nextF(), rand.nextF(), rand.nextF()});
+            paint.setShader(shaders[i % 3]);
+            paint.setBlendMode(i & 1 ? GBlendMode::kSrcOver : GBlendMode::kSrc);
+            // A point partway along the top keeps the polygon from being an axis-aligned quad,
+            // which drawConvexPolygon would fill as a rect too
+            const GPoint corners[] = { {r.fLeft, r.fTop}, {r.fLeft + r.width() / 3, r.fTop},
+                                       {r.fRight, r.fTop}, {r.fRight, r.fBottom},
+                                       {r.fLeft, r.fBottom} };
+            rectCanvas->drawRect(r, paint);
+            polyCanvas->drawConvexPolygon(corners, 5, paint);
+        }
+        ok &= !memcmp(rectBm.pixels(), polyBm.pixels(), H * rectBm.rowBytes());
+    }
+    stats->expectTrue(ok, "axis_aligned_rect");
+
+    free(rectBm.pixels());
+    free(polyBm.pixels());
+}
+
+// drawBitmap blits rows straight from the bitmap when it lands on whole pixels; on any canvas it
+// must draw what filling its bounds with a clamped bitmap shader draws
+static void test_draw_bitmap(GTestStats* stats) {
+    const int W = 80, H = 70;
+    GBitmap bitmapBm, shaderBm, tiledBm, opaque, translucent;
+    setup_bitmap(&bitmapBm, W, H);
+    setup_bitmap(&shaderBm, W, H);
+    setup_bitmap(&tiledBm, W, H);
+    setup_bitmap(&opaque, 23, 17);
+    setup_bitmap(&translucent, 31, 12);
+    GRandom rand;
+    for (int y = 0; y < opaque.height(); ++y) {
+        for (int x = 0; x < opaque.width(); ++x) {
+            *opaque.getAddr(x, y) = rand_premul(rand) | 0xFF000000;
+        }
+    }
+    opaque.setIsOpaque(GBitmap::kCompute_IsOpaque);
+    for (int y = 0; y < translucent.height(); ++y) {
+        for (int x = 0; x < translucent.width(); ++x) {
+            *translucent.getAddr(x, y) = rand_premul(rand);
+        }
+    }
+    translucent.setIsOpaque(GBitmap::kCompute_IsOpaque);
+
+    const GBlendMode modes[] = { GBlendMode::kSrcOver, GBlendMode::kSrc, GBlendMode::kClear,
+                                 GBlendMode::kDst, GBlendMode::kDstIn, GBlendMode::kXor };
+    const GMatrix matrices[] = {
+        GMatrix(), GMatrix::MakeTranslate(-7, 12), GMatrix::MakeTranslate(0.5f, 3),
+        GMatrix::MakeScale(1.5f, 0.75f),
+    };
+    bool ok = true;
+    for (int m = 0; m < 4; ++m) {
+        auto bitmapCanvas = GCreateCanvas(bitmapBm);
+        auto shaderCanvas = GCreateCanvas(shaderBm);
+        auto tiledCanvas = GCreateCanvas(tiledBm, 3);
+        GCanvas* canvases[] = { bitmapCanvas.get(), shaderCanvas.get(), tiledCanvas.get() };
+        for (GCanvas* canvas : canvases) {
+            canvas->clear({0.5f, 0.25f, 0.5f, 1});
+            canvas->concat(matrices[m]);
+        }
+        for (int i = 0; i < 40; ++i) {
+            const GBitmap& bm = i & 1 ? opaque : translucent;
+            // Whole pixels, mostly, and partly or fully off the device
+            float x = (int)(rand.nextF() * 120) - 30;
+            float y = (int)(rand.nextF() * 110) - 30;
+            if (i % 7 == 0) {
+                x += 0.25f;
+            }
+            GPaint paint;
+            paint.setBlendMode(modes[i % 6]);
+            paint.setAntiAlias(i % 5 == 0);
+            bitmapCanvas->drawBitmap(bm, x, y, paint);
+            tiledCanvas->drawBitmap(bm, x, y, paint);
+            auto shader = GCreateBitmapShader(bm, GMatrix::MakeTranslate(x, y));
+            paint.setShader(shader.get());
+            shaderCanvas->drawRect(GRect::MakeXYWH(x, y, bm.width(), bm.height()), paint);
+        }
+        tiledCanvas->flush();
+        ok &= !memcmp(bitmapBm.pixels(), shaderBm.pixels(), H * bitmapBm.rowBytes());
+        ok &= !memcmp(tiledBm.pixels(), shaderBm.pixels(), H * tiledBm.rowBytes());
+    }
+    stats->expectTrue(ok, "draw_bitmap");
+
+    free(bitmapBm.pixels());
+    free(shaderBm.pixels());
+    free(tiledBm.pixels());
+    free(opaque.pixels());
+    free(translucent.pixels());
+}
+
+// Zoomed-in paths whose curves leave the device: a curve wholly left or right of it fills as the
+// line between its ends (only anti-aliasing sees the difference), one wholly above or below
+// fills as nothing. Draws wholly off the device are rejected before the mask cache sees them.
+static void test_offscreen_curves(GTestStats* stats) {
+    const int W = 100, H = 80;
+    GBitmap curvesBm, linesBm;
+    setup_bitmap(&curvesBm, W, H);
+    setup_bitmap(&linesBm, W, H);
+    GPath path;
+    path.addCircle({50, 40}, 30);
+    GRandom rand;
+    path.moveTo(rand.nextF() * 100, rand.nextF() * 80);
+    for (int i = 0; i < 12; ++i) {
+        auto p = [&rand]() { return GPoint{rand.nextF() * 400 - 150, rand.nextF() * 300 - 110}; };
+        if (i & 1) {
+            path.quadTo(p(), p());
+        } else {
+            path.cubicTo(p(), p(), p());
+        }
+    }
+    const GMatrix matrices[] = {
+        GMatrix(), GMatrix(6, 0, -250, 0, 6, -200), GMatrix(3.5f, 0, 30, 0, -2.5f, 160),
+        GMatrix(0.5f, 0.25f, 20, -0.25f, 2, 10),
+    };
+
+    bool ok = true;
+    for (const GMatrix& ctm : matrices) {
+        for (int aa = 0; aa < 2; ++aa) {
+            // The same contours, with the curves the rasterizer may cull done by hand
+            GPath lines;
+            GPath::Iter iter(path);
+            GPoint pts[GPath::kMaxEdgerPoints];
+            for (GPath::Verb verb; (verb = iter.next(pts)) != GPath::kDone;) {
+                const int count = verb == GPath::kMove ? 1 : (int)verb + 1;
+                GPoint dev[GPath::kMaxEdgerPoints];
+                ctm.mapPoints(dev, pts, count);
+                float l = dev[0].fX, t = dev[0].fY, r = l, b = t;
+                for (int i = 1; i < count; ++i) {
+                    l = std::min(l, dev[i].fX);
+                    r = std::max(r, dev[i].fX);
+                    t = std::min(t, dev[i].fY);
+                    b = std::max(b, dev[i].fY);
+                }
+                const bool offRows = b < -2 || t > H + 2;
+                const bool offColumns = r < -2 || l > W + 2;
+                if (verb == GPath::kMove) {
+                    lines.moveTo(pts[0]);
+                } else if (verb == GPath::kLine || offRows || (!aa && offColumns)) {
+                    lines.lineTo(pts[count - 1]);
+                } else if (verb == GPath::kQuad) {
+                    lines.quadTo(pts[1], pts[2]);
+                } else {
+                    lines.cubicTo(pts[1], pts[2], pts[3]);
+                }
+            }
+            GPaint paint({0.9f, 0.2f, 0.6f, 0.3f});
+            paint.setAntiAlias(aa);
+            auto curvesCanvas = GCreateCanvas(curvesBm);
+            auto linesCanvas = GCreateCanvas(linesBm);
+            curvesCanvas->clear({1, 1, 1, 1});
+            linesCanvas->clear({1, 1, 1, 1});
+            curvesCanvas->concat(ctm);
+            linesCanvas->concat(ctm);
+            curvesCanvas->drawPath(path, paint);
+            linesCanvas->drawPath(lines, paint);
+            ok &= !memcmp(curvesBm.pixels(), linesBm.pixels(), H * curvesBm.rowBytes());
+
+            const GPathMaskCacheStats before = GGetPathMaskCacheStats();
+            curvesCanvas->translate(1000, 0);
+            curvesCanvas->drawPath(path, paint);
+            curvesCanvas->translate(-2000, -3000);
+            curvesCanvas->drawPath(path, paint);
+            const GPathMaskCacheStats after = GGetPathMaskCacheStats();
+            ok &= after.fHits == before.fHits && after.fMisses == before.fMisses;
+            ok &= !memcmp(curvesBm.pixels(), linesBm.pixels(), H * curvesBm.rowBytes());
+        }
+    }
+    stats->expectTrue(ok, "offscreen_curves");
+
+    free(curvesBm.pixels());
+    free(linesBm.pixels());
+}
+
+// drawPath steps runs of lines inside the device as single chained edges. Bands of the tiled
+// canvas start partway down those chains, and must still fill exactly as a whole-device walk.
+static void test_path_edge_chains(GTestStats* stats) {
+    const int W = 160, H = 150;
+    GBitmap single, tiled;
+    setup_bitmap(&single, W, H);
+    setup_bitmap(&tiled, W, H);
+    auto singleCanvas = GCreateCanvas(single);
+    auto tiledCanvas = GCreateCanvas(tiled, 4);
+    GCanvas* canvases[] = { singleCanvas.get(), tiledCanvas.get() };
+    GRandom rand;
+    for (int i = 0; i < 40; ++i) {
+        GPath path;
+        const GPoint center = { rand.nextF() * 200 - 20, rand.nextF() * 190 - 20 };
+        const float r = 5 + rand.nextF() * 70;
+        path.addCircle(center, r);
+        path.addCircle(center, r * 0.6f, GPath::kCCW_Direction);
+        path.moveTo(center.fX - r, center.fY);
+        for (int k = 0; k < 8; ++k) {
+            const float x = center.fX - r + k * r / 4;
+            path.cubicTo(x + r / 12, center.fY - r, x + r / 6, center.fY + r, x + r / 4, center.fY);
+        }
+        GPaint paint({0.6f, rand.nextF(), rand.nextF(), rand.nextF()});
+        for (GCanvas* canvas : canvases) {
+            canvas->drawPath(path, paint);
+        }
+    }
+    tiledCanvas->flush();
+    stats->expectTrue(!memcmp(single.pixels(), tiled.pixels(), H * single.rowBytes()),
+                      "path_edge_chains");
+
+    free(single.pixels());
+    free(tiled.pixels());
+}
+
+// GPath caches its convexity until it changes, and drawPath fills convex paths with a two-sided
+// walker that must match the general scan: the same shapes with a stray empty contour (which
+// makes them non-convex) must fill identically, whole or clipped, on one thread or in bands.
+static void test_path_convexity(GTestStats* stats) {
+    bool ok = true;
+    GPath::Direction dir;
+    GPath path;
+    path.addRect(GRect::MakeLTRB(1, 2, 30, 40));
+    ok &= path.isConvex(&dir) && dir == GPath::kCW_Direction;
+    path.reset().addRect(GRect::MakeLTRB(1, 2, 30, 40), GPath::kCCW_Direction);
+    ok &= path.isConvex(&dir) && dir == GPath::kCCW_Direction;
+    path.reset().addCircle({50, 50}, 20, GPath::kCCW_Direction);
+    GPath::Direction circleDir;
+    ok &= path.isConvex(&circleDir);
+    path.transform(GMatrix::MakeScale(-1, 1));
+    ok &= path.isConvex(&dir) && dir != circleDir;
+    path.lineTo(-50, 50);
+    ok &= !path.isConvex();
+
+    const GPoint arrow[] = {{0, 0}, {10, 5}, {20, 0}, {10, 20}};
+    const GPoint star[] = {{10, 0}, {16, 18}, {0, 7}, {20, 7}, {4, 18}};
+    const GPoint line[] = {{0, 0}, {10, 10}, {20, 20}};
+    ok &= !path.reset().addPolygon(arrow, 4).isConvex();
+    ok &= !path.reset().addPolygon(star, 5).isConvex();
+    ok &= !path.reset().addPolygon(line, 3).isConvex();
+    ok &= !path.reset().isConvex();
+    ok &= !path.reset().addRect(GRect::MakeLTRB(0, 0, 5, 5))
+                       .addRect(GRect::MakeLTRB(10, 0, 15, 5)).isConvex();
+
+    path.reset().addPolygon(arrow, 3);
+    ok &= path.isConvex();
+    GPath copy;
+    copy = path;
+    copy.lineTo(arrow[3]);
+    ok &= path.isConvex() && !copy.isConvex();
+
+    const int W = 160, H = 150;
+    GBitmap convexBm, generalBm, tiledBm;
+    setup_bitmap(&convexBm, W, H);
+    setup_bitmap(&generalBm, W, H);
+    setup_bitmap(&tiledBm, W, H);
+    auto convexCanvas = GCreateCanvas(convexBm);
+    auto generalCanvas = GCreateCanvas(generalBm);
+    auto tiledCanvas = GCreateCanvas(tiledBm, 4);
+    GRandom rand;
+    for (int i = 0; i < 60; ++i) {
+        GPath convex;
+        const GPoint center = { rand.nextF() * 240 - 40, rand.nextF() * 230 - 40 };
+        const float r = 3 + rand.nextF() * 90;
+        if (i % 3 == 0) {
+            convex.addCircle(center, r, i & 1 ? GPath::kCW_Direction : GPath::kCCW_Direction);
+        } else {
+            // Random angles around the center, in order
+            GPoint pts[12];
+            const int n = 3 + i % 10;
+            float angle = rand.nextF();
+            for (int k = 0; k < n; ++k) {
+                angle += (0.2f + 0.8f * rand.nextF()) * 6.28f / n;
+                pts[k] = { center.fX + r * cosf(angle), center.fY + r * sinf(angle) };
+            }
+            convex.addPolygon(pts, n);
+        }
+        ok &= convex.isConvex();
+        GPath general = convex;
+        general.moveTo(center).lineTo(center);
+        ok &= !general.isConvex();
+
+        const GMatrix ctm = GMatrix::MakeRotate(rand.nextF()).postScale(1, 0.5f + rand.nextF());
+        GPaint paint({0.6f, rand.nextF(), rand.nextF(), rand.nextF()});
+        for (GCanvas* canvas : { convexCanvas.get(), generalCanvas.get(), tiledCanvas.get() }) {
+            canvas->save();
+            canvas->translate(center.fX, center.fY);
+            canvas->concat(ctm);
+            canvas->translate(-center.fX, -center.fY);
+            canvas->drawPath(canvas == generalCanvas.get() ? general : convex, paint);
+            canvas->restore();
+        }
+    }
+    tiledCanvas->flush();
+    ok &= !memcmp(convexBm.pixels(), generalBm.pixels(), H * convexBm.rowBytes());
+    ok &= !memcmp(convexBm.pixels(), tiledBm.pixels(), H * convexBm.rowBytes());
+    stats->expectTrue(ok, "path_convexity");
+
+    free(convexBm.pixels());
+    free(generalBm.pixels());
+    free(tiledBm.pixels());
+}
+
+// Reference for drawConvexPolygon inside the device: the scan it has always done. One edge per
+// line with rows, sorted by top row, then x, then slope. The first two edges are the sides, and a
+// side takes the next sorted edge the row after its edge ends. Edges step x in fixed point with
+// 32 fractional bits, and a span covers the pixels whose centers x rounds past.
+struct RefPolygonEdge {
+    int     fTop, fBottom;
+    int64_t fX, fSlope;
+
+    bool operator<(const RefPolygonEdge& e) const {
+        if (fTop != e.fTop) {
+            return fTop < e.fTop;
+        }
+        return fX != e.fX ? fX < e.fX : fSlope < e.fSlope;
+    }
+};
+
+static void ref_convex_polygon(const GBitmap& bm, const GPoint pts[], int count, GPixel pixel) {
+    std::vector<RefPolygonEdge> edges;
+    for (int i = 0; i < count; ++i) {
+        GPoint top = pts[i], bot = pts[(i + 1) % count];
+        if (top.fY == bot.fY) {
+            continue;
+        }
+        if (!(top.fY < bot.fY)) {
+            std::swap(top, bot);
+        }
+        const float m = (bot.fX - top.fX) / (bot.fY - top.fY);
+        const int t = GRoundToInt(top.fY), b = GRoundToInt(bot.fY);
+        if (t != b) {
+            const double x = top.fX + m * (t - top.fY + 0.5);
+            edges.push_back({ t, b, (int64_t)floor(x * 4294967296.0 + 0.5),
+                              (int64_t)floor(m * 4294967296.0 + 0.5) });
+        }
+    }
+    if (edges.empty()) {
+        return;
+    }
+    std::sort(edges.begin(), edges.end());
+    int bottom = edges[0].fBottom;
+    for (const RefPolygonEdge& e : edges) {
+        bottom = std::max(bottom, e.fBottom);
+    }
+    RefPolygonEdge side[2] = { edges[0], edges[1] };
+    size_t next = 2;
+    for (int y = edges[0].fTop; y < bottom; ++y) {
+        const int l = std::min(std::max((int)((side[0].fX + (1ll << 31)) >> 32), 0),
+                               bm.width() - 1);
+        const int r = std::min((int)((side[1].fX + (1ll << 31)) >> 32), bm.width() - 1);
+        for (int x = l; x < r; ++x) {
+            *bm.getAddr(x, y) = pixel;
+        }
+        for (RefPolygonEdge& e : side) {
+            e.fX += e.fSlope;
+            if (e.fBottom <= y && next < edges.size()) {
+                e = edges[next++];
+            }
+        }
+    }
+}
+
+// drawConvexPolygon walks the chains down from the top vertex instead of sorting an edge list,
+// with its own code for triangles and quads. Random convex polygons inside the device, some with
+// points on half pixels where rounding ties, must fill exactly as the sorted scan does.
+static void test_convex_polygon_chains(GTestStats* stats) {
+    const int W = 120, H = 100;
+    GBitmap drawBm, refBm;
+    setup_bitmap(&drawBm, W, H);
+    setup_bitmap(&refBm, W, H);
+    auto canvas = GCreateCanvas(drawBm);
+    GRandom rand;
+    bool ok = true;
+    for (int i = 0; i < 300; ++i) {
+        const int n = i % 3 == 0 ? 3 : (i % 3 == 1 ? 4 : 5 + i % 30);
+        const GPoint center = { 10 + rand.nextF() * (W - 20), 10 + rand.nextF() * (H - 20) };
+        const float maxR = std::min(std::min(center.fX, W - center.fX),
+                                    std::min(center.fY, H - center.fY));
+        const float rx = maxR * (0.1f + 0.9f * rand.nextF());
+        const float ry = maxR * (0.1f + 0.9f * rand.nextF());
+        GPoint pts[40];
+        float angle = rand.nextF() * 6.28f;
+        for (int k = 0; k < n; ++k) {
+            angle += (0.2f + 0.8f * rand.nextF()) * 6.28f / n;
+            pts[k] = { center.fX + rx * cosf(angle), center.fY + ry * sinf(angle) };
+            if (i % 4 == 3) {
+                pts[k] = { floorf(pts[k].fX) + 0.5f, floorf(pts[k].fY) + 0.5f };
+            }
+        }
+        memset(drawBm.pixels(), 0, H * drawBm.rowBytes());
+        memset(refBm.pixels(), 0, H * refBm.rowBytes());
+        canvas->drawConvexPolygon(pts, n, GPaint({1, 1, 1, 1}));
+        ref_convex_polygon(refBm, pts, n, GPixel_PackARGB(0xFF, 0xFF, 0xFF, 0xFF));
+        ok &= !memcmp(drawBm.pixels(), refBm.pixels(), H * drawBm.rowBytes());
+    }
+    stats->expectTrue(ok, "convex_polygon_chains");
+
+    free(drawBm.pixels());
+    free(refBm.pixels());
+}
+
+// Edges step in fixed point, which adds no error row after row the way float sums do. Down a
+// device thousands of rows tall, each row of a long edge must start at the pixel its exact x
+// rounds to, for polygons and for paths (rows where x is too near a tie to tell are skipped).
+static void test_edge_stepping(GTestStats* stats) {
+    const int W = 64, H = 4000;
+    GBitmap bm;
+    setup_bitmap(&bm, W, H);
+    auto canvas = GCreateCanvas(bm);
+    GRandom rand;
+    bool ok = true;
+    for (int i = 0; i < 16; ++i) {
+        const GPoint top = { 2 + rand.nextF() * 20, rand.nextF() * 3 };
+        const GPoint bot = { 2 + rand.nextF() * 20, H - rand.nextF() * 3 };
+        const GPoint pts[] = { top, { W + 1.0f, top.fY }, { W + 1.0f, bot.fY }, bot };
+        memset(bm.pixels(), 0, H * bm.rowBytes());
+        if (i & 1) {
+            GPath path;
+            path.addPolygon(pts, 4);
+            canvas->drawPath(path, GPaint({1, 1, 1, 1}));
+        } else {
+            canvas->drawConvexPolygon(pts, 4, GPaint({1, 1, 1, 1}));
+        }
+        const float m = (bot.fX - top.fX) / (bot.fY - top.fY);
+        for (int y = GRoundToInt(top.fY); y < GRoundToInt(bot.fY); ++y) {
+            const double x = top.fX + (double)m * (y + 0.5 - top.fY);
+            if (fabs(x - floor(x) - 0.5) < 1e-6) {
+                continue;
+            }
+            int left = 0;
+            while (left < W && *bm.getAddr(left, y) == 0) {
+                left += 1;
+            }
+            ok &= left == (int)floor(x + 0.5);
+        }
+    }
+    stats->expectTrue(ok, "edge_stepping");
+
+    free(bm.pixels());
+}
+
+// Paths with thousands of edges, more than one crossing most rows, must fill exactly the pixels
+// whose centers have a non-zero winding number, counting each edge's crossing of the row's center
+// at the pixel it rounds to (rows with a crossing too near a tie to tell are skipped).
+static void test_path_many_edges(GTestStats* stats) {
+    const int W = 256, H = 256;
+    GBitmap bm;
+    setup_bitmap(&bm, W, H);
+    auto canvas = GCreateCanvas(bm);
+    GRandom rand;
+    bool ok = true;
+    for (int n = 1001; n <= 1004; ++n) {
+        std::vector<GPoint> pts(n);
+        for (int i = 0; i < n; ++i) {
+            const float angle = i * 4 * 3.14159265f / n + rand.nextF() * 0.01f;
+            const float r = 10 + rand.nextF() * 115;
+            pts[i] = { 128 + r * cosf(angle), 128 + r * sinf(angle) };
+        }
+        GPath path;
+        path.addPolygon(pts.data(), n);
+        memset(bm.pixels(), 0, H * bm.rowBytes());
+        canvas->drawPath(path, GPaint({1, 1, 1, 1}));
+
+        for (int y = 0; y < H; ++y) {
+            std::vector<int> winding(W + 1, 0);
+            bool tie = false;
+            for (int i = 0; i < n; ++i) {
+                GPoint top = pts[i], bot = pts[(i + 1) % n];
+                int w = 1;
+                if (top.fY > bot.fY) {
+                    std::swap(top, bot);
+                    w = -1;
+                }
+                if (!(GRoundToInt(top.fY) <= y && y < GRoundToInt(bot.fY))) {
+                    continue;
+                }
+                const float m = (bot.fX - top.fX) / (bot.fY - top.fY);
+                const double x = top.fX + (double)m * (y + 0.5 - top.fY);
+                tie |= fabs(x - floor(x) - 0.5) < 1e-4;
+                winding[std::max(0, std::min(W, (int)floor(x + 0.5)))] += w;
+            }
+            if (tie) {
+                continue;
+            }
+            int a = 0;
+            for (int x = 0; x < W; ++x) {
+                a += winding[x];
+                ok &= (*bm.getAddr(x, y) != 0) == (a != 0);
+            }
+        }
+    }
+    stats->expectTrue(ok, "path_many_edges");
+
+    free(bm.pixels());
+}
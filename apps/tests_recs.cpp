@@ -226,6 +226,7 @@ static void test_offscreen_poly(GTestStats* stats) {
 #include "tests_pa3.cpp"
 #include "tests_pa4.cpp"
 #include "tests_pa5.cpp"
+#include "tests_raster.cpp"
 
 const GTestRec gTestRecs[] = {
     { test_clear,       "clear"         },
@@ -246,6 +247,28 @@ const GTestRec gTestRecs[] = {
     { test_edger_quads, "test_edger_quads"  },
     { test_path_circle, "test_path_circle"  },
 
+    { test_blend_rows,  "blend_rows"        },
+    { test_shader_contexts, "shader_contexts" },
+    { test_shader_split_rows, "shader_split_rows" },
+    { test_gradient_table, "gradient_table" },
+    { test_gradient_seams, "gradient_seams" },
+    { test_bitmap_sampling, "bitmap_sampling" },
+    { test_mesh_coverage, "mesh_coverage" },
+    { test_quad_levels, "quad_levels"       },
+    { test_tiled_canvas, "tiled_canvas"     },
+    { test_steady_state_allocs, "steady_state_allocs" },
+    { test_antialias,   "antialias"         },
+    { test_path_mask_cache, "path_mask_cache" },
+    { test_matrix_types, "matrix_types"     },
+    { test_axis_aligned_rect, "axis_aligned_rect" },
+    { test_draw_bitmap, "draw_bitmap"       },
+    { test_offscreen_curves, "offscreen_curves" },
+    { test_path_edge_chains, "path_edge_chains" },
+    { test_path_convexity, "path_convexity" },
+    { test_convex_polygon_chains, "convex_polygon_chains" },
+    { test_edge_stepping, "edge_stepping"   },
+    { test_path_many_edges, "path_many_edges" },
+
     { nullptr, nullptr },
 };
 
@@ -0,0 +1,178 @@
+/*
+ *  Bump allocator for short-lived, per-draw objects.
+ */
+
+#ifndef GArena_DEFINED
+#define GArena_DEFINED
+
+#include "GTypes.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ *  Hands out memory by bumping a pointer through a list of blocks. Nothing is freed one object
+ *  at a time: rewind() drops everything allocated after a mark() (running destructors), and the
+ *  blocks are kept, so once an arena has grown to fit a workload it stops allocating.
+ */
+class GArena {
+public:
+    GArena(size_t firstBlockSize = 4096) : fFirstBlockSize(firstBlockSize) {}
+    ~GArena() {
+        this->reset();
+        for (Block& block : fBlocks) {
+            ::operator delete(block.fStorage);
+        }
+    }
+
+    GArena(const GArena&) = delete;
+    GArena& operator=(const GArena&) = delete;
+
+    struct Mark {
+        int     fBlock;
+        size_t  fUsed;
+        void*   fDtors;
+    };
+
+    Mark mark() const { return { fCurrent, fUsed, fDtors }; }
+
+    // Destroy everything made since the mark, newest first, and reuse its memory
+    void rewind(const Mark& mark) {
+        while (fDtors != mark.fDtors) {
+            Dtor* dtor = (Dtor*)fDtors;
+            dtor->fProc(dtor->fObject);
+            fDtors = dtor->fPrev;
+        }
+        fCurrent = mark.fBlock;
+        fUsed = mark.fUsed;
+    }
+
+    void reset() { this->rewind({ 0, 0, nullptr }); }
+
+    // Uninitialized storage for count T's, aligned to at least 16 bytes (or align, a power of 2)
+    template <typename T> T* makeArray(size_t count, size_t align = 16) {
+        return (T*)this->alloc(count * sizeof(T), std::max(align, alignof(T)));
+    }
+
+    template <typename T, typename... Args> T* make(Args&&... args) {
+        void* storage = this->alloc(sizeof(T), alignof(T));
+        T* object = new (storage) T(std::forward<Args>(args)...);
+        Dtor* dtor = (Dtor*)this->alloc(sizeof(Dtor), alignof(Dtor));
+        dtor->fProc = [](void* ptr) { ((T*)ptr)->~T(); };
+        dtor->fObject = object;
+        dtor->fPrev = fDtors;
+        fDtors = dtor;
+        return object;
+    }
+
+    // Bytes reserved in blocks, whether or not they are in use
+    size_t capacity() const {
+        size_t total = 0;
+        for (const Block& block : fBlocks) {
+            total += block.fSize;
+        }
+        return total;
+    }
+
+private:
+    struct Block {
+        char*   fStorage;
+        size_t  fSize;
+    };
+    struct Dtor {
+        void  (*fProc)(void*);
+        void*   fObject;
+        void*   fPrev;
+    };
+
+    void* alloc(size_t size, size_t align) {
+        while (fCurrent < (int)fBlocks.size()) {
+            Block& block = fBlocks[fCurrent];
+            size_t start = (fUsed + align - 1) & ~(align - 1);
+            if (start + size <= block.fSize) {
+                fUsed = start + size;
+                return block.fStorage + start;
+            }
+            fCurrent += 1;
+            fUsed = 0;
+        }
+        // Out of blocks: each new one at least doubles what we had
+        size_t blockSize = std::max(size + align, std::max(fFirstBlockSize, this->capacity()));
+        fBlocks.push_back({ (char*)::operator new(blockSize), blockSize });
+        fCurrent = (int)fBlocks.size() - 1;
+        fUsed = 0;
+        return this->alloc(size, align);
+    }
+
+    std::vector<Block>  fBlocks;
+    int                 fCurrent = 0;
+    size_t              fUsed = 0;
+    void*               fDtors = nullptr;
+    const size_t        fFirstBlockSize;
+};
+
+/**
+ *  A growable array of trivially copyable T's, stored in an arena. Growing copies into a new
+ *  allocation twice the size and leaves the old one until the arena rewinds, so reserving the
+ *  final size up front wastes nothing.
+ */
+template <typename T> class GArenaArray {
+public:
+    GArenaArray(GArena* arena, int reserve = 0) : fArena(arena) {
+        if (reserve > 0) {
+            this->grow(reserve);
+        }
+    }
+
+    int size() const { return fCount; }
+    bool empty() const { return fCount == 0; }
+
+    T* data() { return fData; }
+    T* begin() { return fData; }
+    T* end() { return fData + fCount; }
+    T& operator[](int index) { return fData[index]; }
+    const T& operator[](int index) const { return fData[index]; }
+
+    void push_back(const T& value) {
+        if (fCount == fCapacity) {
+            this->grow(std::max(2 * fCapacity, 16));
+        }
+        new (&fData[fCount++]) T(value);
+    }
+
+    // Drop everything from count on
+    void truncate(int count) { fCount = std::min(fCount, count); }
+    void clear() { fCount = 0; }
+
+private:
+    void grow(int capacity) {
+        T* data = fArena->makeArray<T>(capacity);
+        if (fCount > 0) {
+            memcpy(data, fData, fCount * sizeof(T));
+        }
+        fData = data;
+        fCapacity = capacity;
+    }
+
+    GArena* fArena;
+    T*      fData = nullptr;
+    int     fCount = 0;
+    int     fCapacity = 0;
+};
+
+/**
+ *  Rewinds the arena, when it goes out of scope, to where it was when this was constructed.
+ */
+class GArenaScope {
+public:
+    GArenaScope(GArena* arena) : fArena(arena), fMark(arena->mark()) {}
+    ~GArenaScope() { fArena->rewind(fMark); }
+
+private:
+    GArena*         fArena;
+    GArena::Mark    fMark;
+};
+
+#endif
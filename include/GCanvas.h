@@ -121,6 +121,19 @@ public:
     virtual void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
                           int level, const GPaint&) = 0;
 
+    /**
+     *  Draw the bitmap with its top-left corner at (x, y), transformed by the CTM. The pixels are
+     *  those of filling the bitmap's bounds with a clamped bitmap shader; only the paint's
+     *  blendmode and anti-aliasing are used.
+     */
+    virtual void drawBitmap(const GBitmap&, float x, float y, const GPaint&);
+
+    /**
+     *  Finish any drawing the canvas has deferred, so the bitmap holds the result of every call
+     *  made so far. Canvases that draw immediately have nothing to do.
+     */
+    virtual void flush() {}
+
     // Helpers
 
     void translate(float x, float y) {
@@ -152,6 +165,28 @@ public:
  */
 std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap);
 
+/**
+ *  Same as above, but if threadCount > 1 the canvas records its draws and rasterizes them on
+ *  threadCount threads when flush() is called (or the canvas is destroyed). The pixels are
+ *  identical to what the single-threaded canvas produces.
+ *
+ *  Draws whose paint has a shader run right away, since the paint does not own the shader.
+ */
+std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap, int threadCount);
+
+/**
+ *  Canvases cache the masks of paths that drawPath() draws more than once, keyed by the path, the
+ *  rows drawn and the exact CTM: moving a path by any fraction of a pixel misses. These are the
+ *  totals over every canvas.
+ */
+struct GPathMaskCacheStats {
+    uint64_t fHits;
+    uint64_t fMisses;
+    uint64_t fEvictions;
+    uint64_t fBytes;        // held right now
+};
+GPathMaskCacheStats GGetPathMaskCacheStats();
+
 /**
  *  Implement this, and draw something interesting with polygons, matrices, and shaders.
  *  Dimensions = 512 x 512
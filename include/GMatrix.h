@@ -14,15 +14,36 @@ class GMatrix {
 public:
     GMatrix() { this->setIdentity(); }
     GMatrix(float a, float b, float c, float d, float e, float f) {
-        fMat[0] = a;    fMat[1] = b;    fMat[2] = c;
-        fMat[3] = d;    fMat[4] = e;    fMat[5] = f;
+        this->set6(a, b, c, d, e, f);
     }
 
     void set6(float a, float b, float c, float d, float e, float f) {
         fMat[0] = a;    fMat[1] = b;    fMat[2] = c;
         fMat[3] = d;    fMat[4] = e;    fMat[5] = f;
+        fTypeMask = ComputeTypeMask(fMat);
     }
 
+    /**
+     *  What the matrix does, as bits: none set is identity. A matrix with no kAffine_Mask keeps
+     *  axis-aligned rects axis-aligned.
+     */
+    enum TypeMask {
+        kIdentity_Mask  = 0,
+        kTranslate_Mask = 1 << 0,   // TX or TY is not 0
+        kScale_Mask     = 1 << 1,   // SX or SY is not 1
+        kAffine_Mask    = 1 << 2,   // KX or KY is not 0: rotates or skews
+    };
+
+    unsigned getType() const { return fTypeMask; }
+
+    bool isIdentity() const { return fTypeMask == kIdentity_Mask; }
+
+    // Only translates (or is identity)
+    bool isTranslate() const { return (fTypeMask & ~kTranslate_Mask) == 0; }
+
+    // Only scales and translates
+    bool isScaleTranslate() const { return (fTypeMask & kAffine_Mask) == 0; }
+
     enum {
         SX, KX, TX,
         KY, SY, TY,
@@ -32,7 +53,7 @@ public:
         return fMat[index];
     }
 
-    bool operator==(const GMatrix& m) {
+    bool operator==(const GMatrix& m) const {
         for (int i = 0; i < 6; ++i) {
             if (fMat[i] != m.fMat[i]) {
                 return false;
@@ -181,7 +202,22 @@ public:
     }
 
 private:
-    float fMat[6];
+    static unsigned ComputeTypeMask(const float mat[6]) {
+        unsigned mask = kIdentity_Mask;
+        if (mat[TX] != 0 || mat[TY] != 0) {
+            mask |= kTranslate_Mask;
+        }
+        if (mat[SX] != 1 || mat[SY] != 1) {
+            mask |= kScale_Mask;
+        }
+        if (mat[KX] != 0 || mat[KY] != 0) {
+            mask |= kAffine_Mask;
+        }
+        return mask;
+    }
+
+    float       fMat[6];
+    unsigned    fTypeMask;
 };
 
 #endif
@@ -31,10 +31,16 @@ public:
     GShader* getShader() const { return fShader; }
     GPaint&  setShader(GShader* s) { fShader = s; return *this; }
 
+    // Anti-aliased paints fill rects, polygons and paths by the exact area they cover in each
+    // pixel, rather than by whether they cover its center
+    bool    isAntiAlias() const { return fAntiAlias; }
+    GPaint& setAntiAlias(bool aa) { fAntiAlias = aa; return *this; }
+
 private:
     GColor      fColor = GColor::MakeARGB(1, 0, 0, 0);
     GShader*    fShader = nullptr;
     GBlendMode  fMode = GBlendMode::kSrcOver;
+    bool        fAntiAlias = false;
 };
 
 #endif
@@ -10,6 +10,7 @@ class GMatrix;
 class GPath {
 public:
     GPath();
+    GPath(const GPath&);
     ~GPath();
 
     GPath& operator=(const GPath&);
@@ -73,6 +74,15 @@ public:
 
     int countPoints() const { return (int)fPts.size(); }
 
+    /**
+     *  Return true if the path is a single contour whose points (curves' control points too) make
+     *  a convex polygon, which makes its fill convex. If so and direction is not null, it is set
+     *  to the way the contour turns (kCW_Direction turns right as y goes down).
+     *
+     *  Computed the first time it is asked for, and kept until the path changes.
+     */
+    bool isConvex(Direction* direction = nullptr) const;
+
     /**
      *  Return the bounds of all of the control-points in the path.
      *
@@ -158,8 +168,20 @@ public:
     static void ChopCubicAt(const GPoint src[4], GPoint dst[7], float t);
 
 private:
+    enum Convexity {
+        kUnknown_Convexity,
+        kConvex_Convexity,
+        kConcave_Convexity,
+    };
+    Convexity computeConvexity(Direction*) const;
+
+    // Every change to the points or verbs must forget the cached convexity
+    void invalidateConvexity() { fConvexity = kUnknown_Convexity; }
+
     std::vector<GPoint> fPts;
     std::vector<Verb>   fVbs;
+    mutable Convexity   fConvexity = kUnknown_Convexity;
+    mutable Direction   fDirection = kCW_Direction;
 };
 
 #endif
@@ -6,12 +6,14 @@
 #define GShader_DEFINED
 
 #include <memory>
+#include <mutex>
+#include "GArena.h"
 #include "GColor.h"
+#include "GMatrix.h"
 #include "GPixel.h"
 #include "GPoint.h"
 
 class GBitmap;
-class GMatrix;
 
 /**
  *  GShaders create colors to fill whatever geometry is being drawn to a GCanvas.
@@ -24,12 +26,50 @@ public:
         kMirror,
     };
 
+    /**
+     *  Everything a shader needs to produce rows for one CTM (inverse matrix, tables, ...).
+     *  A context is made once per draw and never changes afterwards, so any number of threads
+     *  may call shadeRow() on the same context at the same time.
+     */
+    class Context {
+    public:
+        virtual ~Context() {}
+
+        /**
+         *  Given a row of pixels in device space [x, y] ... [x + count - 1, y], return the
+         *  corresponding src pixels in row[0...count - 1]. The caller must ensure that row[]
+         *  can hold at least [count] entries.
+         */
+        virtual void shadeRow(int x, int y, int count, GPixel row[]) const = 0;
+
+        /**
+         *  Return true if shadeRow() returns the same pixels for a span whatever its y, so a
+         *  caller filling many rows of the same span may shade it once.
+         */
+        virtual bool isRowInvariant() const { return false; }
+    };
+
     virtual ~GShader() {}
 
     // Return true iff all of the GPixels that may be returned by this shader will be opaque.
     virtual bool isOpaque() = 0;
 
-    // The draw calls in GCanvas must call this with the CTM before any calls to shadeSpan().
+    /**
+     *  Return a context for drawing with this CTM, allocated in the arena (it lives until the
+     *  arena is rewound), or nullptr if the shader can't draw with it (e.g. not invertible).
+     *  The shader itself is not modified, so a shader may be shared between canvases/threads.
+     */
+    virtual Context* makeContext(const GMatrix& ctm, GArena* arena) = 0;
+};
+
+/**
+ *  Base for shaders written before contexts, which implement the setContext() + shadeRow() pair
+ *  and keep their state in the shader. Their contexts shade rows under the shader's lock,
+ *  re-setting the CTM whenever another context used the shader in between.
+ */
+class GLegacyShader : public GShader {
+public:
+    // The draw calls in GCanvas must call this with the CTM before any calls to shadeRow().
     virtual bool setContext(const GMatrix& ctm) = 0;
 
     /**
@@ -38,8 +78,46 @@ public:
      *  can hold at least [count] entries.
      */
     virtual void shadeRow(int x, int y, int count, GPixel row[]) = 0;
+
+    Context* makeContext(const GMatrix& ctm, GArena* arena) override;
+
+private:
+    class LegacyContext;
+
+    std::mutex  fMutex;
+    GMatrix     fCTM;       // the CTM last passed to setContext(), if fHasCTM
+    bool        fHasCTM = false;
 };
 
+class GLegacyShader::LegacyContext : public GShader::Context {
+public:
+    LegacyContext(GLegacyShader* shader, const GMatrix& ctm) : fShader(shader), fCTM(ctm) {}
+
+    void shadeRow(int x, int y, int count, GPixel row[]) const override {
+        std::lock_guard<std::mutex> lock(fShader->fMutex);
+        if (!fShader->fHasCTM || !(fShader->fCTM == fCTM)) {
+            fShader->setContext(fCTM);
+            fShader->fCTM = fCTM;
+            fShader->fHasCTM = true;
+        }
+        fShader->shadeRow(x, y, count, row);
+    }
+
+private:
+    GLegacyShader*  fShader;
+    GMatrix         fCTM;
+};
+
+inline GShader::Context* GLegacyShader::makeContext(const GMatrix& ctm, GArena* arena) {
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (!this->setContext(ctm)) {
+        return nullptr;
+    }
+    fCTM = ctm;
+    fHasCTM = true;
+    return arena->make<LegacyContext>(this, ctm);
+}
+
 /**
  *  Return a subclass of GShader that draws the specified bitmap and a local matrix.
  *  Returns null if the either parameter is invalid.
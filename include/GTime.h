@@ -10,10 +10,14 @@
 #include "GTypes.h"
 
 typedef unsigned long GMSec;
+typedef uint64_t GNSec;
 
 class GTime {
 public:
     static GMSec GetMSec();
+
+    // Nanoseconds from a monotonic clock: only differences are meaningful
+    static GNSec GetNSec();
 };
 
 #endif
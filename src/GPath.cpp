@@ -6,12 +6,16 @@
 #include "GMatrix.h"
 
 GPath::GPath() {}
+GPath::GPath(const GPath& src)
+    : fPts(src.fPts), fVbs(src.fVbs), fConvexity(src.fConvexity), fDirection(src.fDirection) {}
 GPath::~GPath() {}
 
 GPath& GPath::operator=(const GPath& src) {
     if (this != &src) {
         fPts = src.fPts;
         fVbs = src.fVbs;
+        fConvexity = src.fConvexity;
+        fDirection = src.fDirection;
     }
     return *this;
 }
@@ -19,12 +23,14 @@ GPath& GPath::operator=(const GPath& src) {
 GPath& GPath::reset() {
     fPts.clear();
     fVbs.clear();
+    this->invalidateConvexity();
     return *this;
 }
 
 GPath& GPath::moveTo(GPoint p) {
     fPts.push_back(p);
     fVbs.push_back(kMove);
+    this->invalidateConvexity();
     return *this;
 }
 
@@ -32,6 +38,7 @@ GPath& GPath::lineTo(GPoint p) {
     GASSERT(fVbs.size() > 0);
     fPts.push_back(p);
     fVbs.push_back(kLine);
+    this->invalidateConvexity();
     return *this;
 }
 
@@ -40,6 +47,7 @@ GPath& GPath::quadTo(GPoint p1, GPoint p2) {
     fPts.push_back(p1);
     fPts.push_back(p2);
     fVbs.push_back(kQuad);
+    this->invalidateConvexity();
     return *this;
 }
 
@@ -49,6 +57,7 @@ GPath& GPath::cubicTo(GPoint p1, GPoint p2, GPoint p3) {
     fPts.push_back(p2);
     fPts.push_back(p3);
     fVbs.push_back(kCubic);
+    this->invalidateConvexity();
     return *this;
 }
 